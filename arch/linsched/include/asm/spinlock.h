@@ -13,10 +13,15 @@ static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 	return 0;
 }
 
+/* set while rq->lock acquisitions are tracked, see rq_lock_tracking.c */
+extern void (*linsched_spin_lock_hook)(arch_spinlock_t *lock);
+
 static __always_inline void arch_spin_lock(arch_spinlock_t *lock)
 {
 	BUG_ON(lock->slock);
 	lock->slock = 1;
+	if (linsched_spin_lock_hook)
+		linsched_spin_lock_hook(lock);
 }
 
 static __always_inline int arch_spin_trylock(arch_spinlock_t *lock)
@@ -12,12 +12,18 @@ void __switch_to_xtra(struct task_struct *prev_p, struct task_struct *next_p,
 		      struct tss_struct *tss);
 extern void show_regs_common(void);
 
+void track_switch_latency(struct task_struct *prev, struct task_struct *next);
+void trace_switch_decision(struct task_struct *prev, struct task_struct *next);
+
 /*
  * Saving eflags is important. It switches not only IOPL between tasks,
  * it also protects other tasks from NT leaking through sysenter etc.
  */
+
 #define switch_to(prev, next, last)					\
 do {									\
+	track_switch_latency(prev, next);				\
+	trace_switch_decision(prev, next);				\
 	percpu_write(current_task, next);				\
 } while (0)
 
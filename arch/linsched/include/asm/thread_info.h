@@ -46,6 +46,11 @@ struct thread_info {
 	 */
 	struct task_data *td;
 	int id;
+
+	/* run_delay and nr_wakeups when the task was last switched in,
+	 * see track_switch_latency() */
+	unsigned long long lat_run_delay;
+	unsigned long long lat_nr_wakeups;
 };
 
 #define INIT_THREAD_INFO(tsk)			\
@@ -163,19 +168,13 @@ struct thread_info {
 #define __HAVE_ARCH_TASK_STRUCT_ALLOCATOR
 
 #define alloc_task_struct_node(node) ({ (void)node; ((struct task_struct *) linsched_alloc_task_struct()); })
-/*
- * Correct this with the right freeing routine
- */
-#define free_task_struct(tsk)
+#define free_task_struct(tsk) free(tsk)
 
 #define __HAVE_ARCH_THREAD_INFO_ALLOCATOR
 
 #define alloc_thread_info_node(tsk, node)					\
        ((struct thread_info *) linsched_alloc_thread_info(tsk))
-/*
- * Correct this with the right freeing routine
- */
-#define free_thread_info(ti)
+#define free_thread_info(ti) free(ti)
 
 #define __HAVE_THREAD_FUNCTIONS
 
@@ -186,7 +185,9 @@ static unsigned long linsched_stack_end_magic;
 
 #define setup_thread_stack(p, org)                     \
        *task_thread_info(p) = *task_thread_info(org);  \
-       task_thread_info(p)->task = p;
+       task_thread_info(p)->task = p;                  \
+       task_thread_info(p)->lat_run_delay = 0;         \
+       task_thread_info(p)->lat_nr_wakeups = 0;
 
 static inline unsigned long *end_of_stack(struct task_struct *p)
 {
@@ -172,8 +172,33 @@ struct cgroup_taskset {
 };
 
 
+/*
+ * As in the kernel, an exiting task moves to the root cgroup, so that
+ * its cgroup could go away; then its css_set (see cgroup_fork()) is
+ * freed.
+ */
 void cgroup_exit(struct task_struct *tsk, int run_callbacks)
 {
+	struct css_set *cg;
+	int i;
+
+	task_lock(tsk);
+	cg = tsk->cgroups;
+	tsk->cgroups = &init_css_set;
+
+	if (run_callbacks && need_forkexit_callback) {
+		for (i = 0; i < CGROUP_BUILTIN_SUBSYS_COUNT; i++) {
+			struct cgroup_subsys *ss = subsys[i];
+
+			if (ss->exit && cg->subsys[i])
+				ss->exit(ss, task_cgroup(tsk, i),
+					 cg->subsys[i]->cgroup, tsk);
+		}
+	}
+	task_unlock(tsk);
+
+	if (cg != &init_css_set)
+		free(cg);
 }
 
 struct task_struct *cgroup_taskset_first(struct cgroup_taskset *tset)
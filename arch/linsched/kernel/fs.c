@@ -1,24 +1,55 @@
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/fs_struct.h>
 #include <linux/fdtable.h>
 
 void free_fs_struct(struct fs_struct *fs)
 {
-	BUG();
+	kfree(fs);
 }
 
 struct fs_struct *copy_fs_struct(struct fs_struct *old)
 {
-	return kzalloc(sizeof(struct fs_struct), GFP_KERNEL);
+	struct fs_struct *fs = kzalloc(sizeof(struct fs_struct), GFP_KERNEL);
+
+	if (fs)
+		fs->users = 1;
+	return fs;
 }
 
+/*
+ * There are no open files, so a task just gets an empty table of its
+ * own, with the embedded fdtable put_files_struct() expects.
+ */
 struct files_struct *dup_fd(struct files_struct *oldf, int *errorp)
 {
-	return kzalloc(sizeof(struct files_struct), GFP_KERNEL);
+	struct files_struct *newf = kzalloc(sizeof(struct files_struct),
+					    GFP_KERNEL);
+
+	if (!newf) {
+		*errorp = -ENOMEM;
+		return NULL;
+	}
+	atomic_set(&newf->count, 1);
+	newf->fdtab.max_fds = NR_OPEN_DEFAULT;
+	newf->fdtab.fd = &newf->fd_array[0];
+	newf->fdtab.open_fds = (fd_set *)&newf->open_fds_init;
+	newf->fdtab.close_on_exec = (fd_set *)&newf->close_on_exec_init;
+	rcu_assign_pointer(newf->fdt, &newf->fdtab);
+	return newf;
 }
 
-void exit_fs(struct task_struct *p)
+void exit_fs(struct task_struct *tsk)
 {
+	struct fs_struct *fs = tsk->fs;
+
+	if (fs) {
+		task_lock(tsk);
+		tsk->fs = NULL;
+		task_unlock(tsk);
+		if (!--fs->users)
+			free_fs_struct(fs);
+	}
 }
 
 int filp_close(struct file *filp, fl_owner_t id)
@@ -3,6 +3,8 @@
 #include <linux/sched.h>
 #include <linux/tick.h>
 
+#include "sim_profile.h"
+
 unsigned long linsched_irq_flags = ARCH_IRQ_ENABLED;
 
 static struct softirq_action softirq_vec[NR_SOFTIRQS];
@@ -11,6 +13,9 @@ cpumask_t linsched_cpu_softirq_raised;
 
 irq_cpustat_t irq_stat[NR_CPUS];
 
+/* softirqs always run on irq exit, there are no ksoftirqd threads */
+DEFINE_PER_CPU(struct task_struct *, ksoftirqd);
+
 #define __local_bh_enable(cnt) sub_preempt_count(cnt)
 #define __local_bh_disable(cnt) add_preempt_count(cnt)
 
@@ -41,8 +46,13 @@ void do_softirq(void)
 		set_softirq_pending(0);
 		h = softirq_vec;
 		do {
-			if (pending & 1)
+			if (pending & 1) {
+				sim_profile_enter(h - softirq_vec == SCHED_SOFTIRQ ?
+						  PHASE_SOFTIRQ_SCHED :
+						  PHASE_SOFTIRQ_HRTIMER);
 				h->action(h);
+				sim_profile_exit();
+			}
 			h++;
 			pending >>= 1;
 		} while (pending);
@@ -1,6 +1,7 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/fs_struct.h>
+#include <linux/fdtable.h>
 #include <linux/module.h>
 #include <linux/nsproxy.h>
 #include <linux/device.h>
@@ -162,9 +163,16 @@ int clocksource_register(struct clocksource *cs)
 	return 0;
 }
 
+/* the tables of dup_fd() are never expanded, they are embedded in
+ * their files_struct */
 void free_fdtable_rcu(struct rcu_head *rcu)
 {
-	BUG();
+	struct fdtable *fdt = container_of(rcu, struct fdtable, rcu);
+	struct files_struct *files =
+		container_of(fdt, struct files_struct, fdtab);
+
+	BUG_ON(fdt->fd != &files->fd_array[0]);
+	kfree(files);
 }
 
 int zap_other_threads(struct task_struct *p)
@@ -210,8 +218,11 @@ void exit_irq_thread(void)
 {
 }
 
+/* there are no signals to hand on, just mark the task as exiting for
+ * cgroup_exit() */
 void exit_signals(struct task_struct *tsk)
 {
+	tsk->flags |= PF_EXITING;
 }
 
 void acct_collect(long exitcode, int group_dead)
@@ -322,20 +333,34 @@ int sysfs_create_file(struct kobject *kobj, const struct attribute * attr)
 }
 
 /* kernel/sysctl.c */
+/* only writes of a single integer, as done by linsched_set_sysctl(),
+ * are supported */
+static int linsched_dointvec(struct ctl_table *table, int write,
+			     void __user *buffer, int *min, int *max)
+{
+	char *end;
+	long val;
+
+	BUG_ON(!write);
+	val = simple_strtol(buffer, &end, 0);
+	if (end == (char *)buffer || val < INT_MIN || val > INT_MAX)
+		return -EINVAL;
+	if ((min && val < *min) || (max && val > *max))
+		return -EINVAL;
+	*(int *)table->data = val;
+
+	return 0;
+}
+
 int proc_dointvec(struct ctl_table *table, int write,
 		  void __user *buffer, size_t *lenp, loff_t *ppos)
 {
-	/* should be unused */
-	BUG();
-
-	return 0;
+	return linsched_dointvec(table, write, buffer, NULL, NULL);
 }
 
 int proc_dointvec_minmax(struct ctl_table *table, int write,
 		    void __user *buffer, size_t *lenp, loff_t *ppos)
 {
-	/* should be unused */
-	BUG();
-
-	return 0;
+	return linsched_dointvec(table, write, buffer, table->extra1,
+				 table->extra2);
 }
@@ -4,18 +4,29 @@
 #include <linux/slab.h>
 
 /* TODO: this is rather.. inelegant */
-static struct pid *pid_mapping[32000];
+#define LINSCHED_PID_MAX 32000
+static struct pid *pid_mapping[LINSCHED_PID_MAX];
 
 /*
- * We don't support namespaces so we just return a
- * pid to be used, which is basically next_pid
+ * We don't support namespaces so we just return a pid to be used.
+ * Like the kernel, pids are handed out in increasing order, wrapping
+ * around past the end to those freed by exited tasks.
  */
 
 static int alloc_pidmap(struct pid_namespace *pid_ns)
 {
-	static int next_pid = 2;
-
-	return next_pid++;
+	static int last_pid = 1;
+	int i, nr = last_pid;
+
+	for (i = 0; i < LINSCHED_PID_MAX - 1; i++) {
+		if (++nr > LINSCHED_PID_MAX)
+			nr = 2;
+		if (!pid_mapping[nr - 1]) {
+			last_pid = nr;
+			return nr;
+		}
+	}
+	return -EAGAIN;
 }
 
 /*
@@ -35,6 +46,8 @@ struct pid *alloc_pid(struct pid_namespace *ns)
 	if (nr < 0)
 		goto out_free;
 
+	atomic_set(&pid->count, 1);
+	pid->level = 0;
 	pid->numbers[i].nr = nr;
 	pid->numbers[i].ns = ns;
 
@@ -48,14 +61,23 @@ out_free:
 	return pid;
 }
 
+/* called once no task uses the pid, the number can be reused */
 void free_pid(struct pid *pid)
 {
-	kfree(pid);
+	int nr = pid->numbers[0].nr;
+
+	if (pid_mapping[nr - 1] == pid)
+		pid_mapping[nr - 1] = NULL;
+	put_pid(pid);
 }
 
 void put_pid(struct pid *pid)
 {
-	BUG();
+	if (!pid || pid == &init_struct_pid)
+		return;
+
+	if (atomic_dec_and_test(&pid->count))
+		kfree(pid);
 }
 
 struct pid *find_get_pid(pid_t nr)
@@ -96,7 +118,18 @@ pid_t pid_vnr(struct pid *pid)
 
 void detach_pid(struct task_struct *task, enum pid_type type)
 {
-	BUG();
+	struct pid_link *link = &task->pids[type];
+	struct pid *pid = link->pid;
+	int tmp;
+
+	hlist_del_rcu(&link->node);
+	link->pid = NULL;
+
+	for (tmp = PIDTYPE_MAX; --tmp >= 0; )
+		if (!hlist_empty(&pid->tasks[tmp]))
+			return;
+
+	free_pid(pid);
 }
 
 /*
@@ -21,9 +21,10 @@ void arch_task_cache_init(void)
 	BUG();
 }
 
+/* signals are never queued in linsched */
 void flush_sigqueue(struct sigpending *queue)
 {
-	BUG();
+	BUG_ON(!list_empty(&queue->list));
 }
 
 void tty_kref_put(struct tty_struct *tty)
@@ -34,9 +35,10 @@ void release_thread(struct task_struct *dead_task)
 {
 }
 
+/* nobody waits for children, so they are reaped right away, as if
+ * their parents ignored SIGCHLD */
 bool do_notify_parent(struct task_struct *tsk, int sig)
 {
-	BUG();
 	return true;
 }
 
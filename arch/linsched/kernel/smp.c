@@ -85,6 +85,10 @@ int native_cpu_up(unsigned int cpunum)
 
 int native_cpu_disable(void)
 {
+	/* as on x86, the boot processor can't be taken down */
+	if (smp_processor_id() == 0)
+		return -EBUSY;
+
 	set_cpu_online(smp_processor_id(), false);
 	return 0;
 }
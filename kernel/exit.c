@@ -868,7 +868,15 @@ static void check_stack_usage(void)
 static inline void check_stack_usage(void) {}
 #endif
 
+#ifdef __LINSCHED__
+/*
+ * The body of do_exit(). linsched's schedule() returns once another task
+ * is current, and so does this, see linsched_exit_task().
+ */
+void linsched_do_exit(long code)
+#else
 void do_exit(long code)
+#endif
 {
 	struct task_struct *tsk = current;
 	int group_dead;
@@ -1039,11 +1047,24 @@ void do_exit(long code)
 	tsk->state = TASK_DEAD;
 	tsk->flags |= PF_NOFREEZE;	/* tell freezer to ignore us */
 	schedule();
+#ifndef __LINSCHED__
+	BUG();
+	/* Avoid "noreturn function does return".  */
+	for (;;)
+		cpu_relax();	/* For when BUG is null */
+#endif
+}
+
+#ifdef __LINSCHED__
+void do_exit(long code)
+{
+	linsched_do_exit(code);
 	BUG();
 	/* Avoid "noreturn function does return".  */
 	for (;;)
 		cpu_relax();	/* For when BUG is null */
 }
+#endif
 
 EXPORT_SYMBOL_GPL(do_exit);
 
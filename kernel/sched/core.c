@@ -848,6 +848,36 @@ void account_system_vtime(struct task_struct *curr)
 }
 EXPORT_SYMBOL_GPL(account_system_vtime);
 
+#ifdef __LINSCHED__
+/*
+ * Interrupts take no simulated time in linsched, so its irq model
+ * charges their handler time here, as account_system_vtime() would
+ * have on {soft,}irq_exit.
+ */
+void linsched_account_irq_time(int cpu, u64 hardirq, u64 softirq)
+{
+	per_cpu(cpu_hardirq_time, cpu) += hardirq;
+	per_cpu(cpu_softirq_time, cpu) += softirq;
+}
+
+/*
+ * The rq->clock_task that update_rq_clock() would set now, without
+ * updating the rq.
+ */
+u64 linsched_rq_clock_task(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	s64 delta = sched_clock() - rq->clock;
+	s64 irq_delta = irq_time_read(cpu) - rq->prev_irq_time;
+
+	if (delta < 0)
+		delta = 0;
+	if (irq_delta > delta)
+		irq_delta = delta;
+	return rq->clock_task + delta - irq_delta;
+}
+#endif
+
 #endif /* CONFIG_IRQ_TIME_ACCOUNTING */
 
 #ifdef CONFIG_PARAVIRT
@@ -1550,6 +1580,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 {
 	unsigned long flags;
 	int cpu, success = 0;
+	int site = rq_lock_site_enter(RQ_LOCK_TTWU);
 
 	smp_wmb();
 	raw_spin_lock_irqsave(&p->pi_lock, flags);
@@ -1605,6 +1636,7 @@ stat:
 	ttwu_stat(p, cpu, wake_flags);
 out:
 	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+	rq_lock_site_exit(site);
 
 	return success;
 }
@@ -6809,6 +6841,7 @@ int in_sched_functions(unsigned long addr)
 
 #ifdef CONFIG_CGROUP_SCHED
 struct task_group root_task_group;
+LIST_HEAD(task_groups);
 #endif
 
 DECLARE_PER_CPU(cpumask_var_t, load_balance_tmpmask);
@@ -7154,6 +7187,7 @@ struct task_group *sched_create_group(struct task_group *parent)
 {
 	struct task_group *tg;
 	unsigned long flags;
+	int i;
 
 	tg = kzalloc(sizeof(*tg), GFP_KERNEL);
 	if (!tg)
@@ -7175,6 +7209,9 @@ struct task_group *sched_create_group(struct task_group *parent)
 	list_add_rcu(&tg->siblings, &parent->children);
 	spin_unlock_irqrestore(&task_group_lock, flags);
 
+	for_each_possible_cpu(i)
+		sync_throttle(tg, i);
+
 	return tg;
 
 err:
@@ -7236,10 +7273,17 @@ void sched_move_task(struct task_struct *tsk)
 #endif
 		set_task_rq(tsk, task_cpu(tsk));
 
-	if (unlikely(running))
-		tsk->sched_class->set_curr_task(rq);
 	if (on_rq)
 		enqueue_task(rq, tsk, 0);
+	if (unlikely(running)) {
+		tsk->sched_class->set_curr_task(rq);
+		/*
+		 * After changing group, the running task may have joined a
+		 * throttled one but it's still the running task. Trigger a
+		 * resched to make sure that task can still run.
+		 */
+		resched_task(tsk);
+	}
 
 	task_rq_unlock(rq, tsk, &flags);
 }
@@ -2067,12 +2067,31 @@ static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 	hrtimer_cancel(&cfs_b->slack_timer);
 }
 
+/* cpu online: bandwidth control is back for the rq's cfs_rqs */
+static void update_runtime_enabled(struct rq *rq)
+{
+	struct task_group *tg;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(tg, &task_groups, list) {
+		struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+		struct cfs_rq *cfs_rq = tg->cfs_rq[cpu_of(rq)];
+
+		raw_spin_lock(&cfs_b->lock);
+		cfs_rq->runtime_enabled = cfs_b->quota != RUNTIME_INF;
+		raw_spin_unlock(&cfs_b->lock);
+	}
+	rcu_read_unlock();
+}
+
 void unthrottle_offline_cfs_rqs(struct rq *rq)
 {
-	struct cfs_rq *cfs_rq;
+	struct task_group *tg;
 
-	for_each_leaf_cfs_rq(rq, cfs_rq) {
-		struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
+	rcu_read_lock();
+	list_for_each_entry_rcu(tg, &task_groups, list) {
+		struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(tg);
+		struct cfs_rq *cfs_rq = tg->cfs_rq[cpu_of(rq)];
 
 		if (!cfs_rq->runtime_enabled)
 			continue;
@@ -2082,9 +2101,34 @@ void unthrottle_offline_cfs_rqs(struct rq *rq)
 		 * there's some valid quota amount
 		 */
 		cfs_rq->runtime_remaining = cfs_b->quota;
+		/*
+		 * Offline rq is schedulable till the cpu is completely
+		 * disabled, e.g. while migrate_tasks() puts the tasks it
+		 * moves, so prevent new cfs throttling here.
+		 */
+		cfs_rq->runtime_enabled = 0;
 		if (cfs_rq_throttled(cfs_rq))
 			unthrottle_cfs_rq(cfs_rq);
 	}
+	rcu_read_unlock();
+}
+
+/*
+ * A group created below a throttled parent starts out throttled too,
+ * or the unthrottle walk would take its throttle_count below zero.
+ */
+void sync_throttle(struct task_group *tg, int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long flags;
+
+	if (!tg->parent)
+		return;
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	tg->cfs_rq[cpu]->throttle_count =
+		tg->parent->cfs_rq[cpu]->throttle_count;
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
 #else /* CONFIG_CFS_BANDWIDTH */
@@ -2121,7 +2165,9 @@ static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
 	return NULL;
 }
 static inline void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b) {}
+static inline void update_runtime_enabled(struct rq *rq) {}
 void unthrottle_offline_cfs_rqs(struct rq *rq) {}
+void sync_throttle(struct task_group *tg, int cpu) {}
 
 #endif /* CONFIG_CFS_BANDWIDTH */
 
@@ -3321,6 +3367,7 @@ static void update_shares(int cpu)
 {
 	struct cfs_rq *cfs_rq;
 	struct rq *rq = cpu_rq(cpu);
+	int site = rq_lock_site_enter(RQ_LOCK_SHARES);
 
 	rcu_read_lock();
 	/*
@@ -3335,6 +3382,7 @@ static void update_shares(int cpu)
 		update_shares_cpu(cfs_rq->tg, cpu);
 	}
 	rcu_read_unlock();
+	rq_lock_site_exit(site);
 }
 
 /*
@@ -4459,6 +4507,7 @@ static int load_balance(int this_cpu, struct rq *this_rq,
 	struct rq *busiest;
 	unsigned long flags;
 	struct cpumask *cpus = __get_cpu_var(load_balance_tmpmask);
+	int site = rq_lock_site_enter(RQ_LOCK_BALANCE);
 
 	cpumask_copy(cpus, cpu_active_mask);
 
@@ -4609,6 +4658,7 @@ out_one_pinned:
 
 	ld_moved = 0;
 out:
+	rq_lock_site_exit(site);
 	return ld_moved;
 }
 
@@ -5044,6 +5094,7 @@ static void nohz_idle_balance(int this_cpu, enum cpu_idle_type idle)
 	struct rq *this_rq = cpu_rq(this_cpu);
 	struct rq *rq;
 	int balance_cpu;
+	int site = rq_lock_site_enter(RQ_LOCK_NOHZ_BALANCE);
 
 	if (idle != CPU_IDLE ||
 	    !test_bit(NOHZ_BALANCE_KICK, nohz_flags(this_cpu)))
@@ -5075,6 +5126,7 @@ static void nohz_idle_balance(int this_cpu, enum cpu_idle_type idle)
 	nohz.next_balance = this_rq->next_balance;
 end:
 	clear_bit(NOHZ_BALANCE_KICK, nohz_flags(this_cpu));
+	rq_lock_site_exit(site);
 }
 
 /*
@@ -5187,6 +5239,8 @@ void trigger_load_balance(struct rq *rq, int cpu)
 static void rq_online_fair(struct rq *rq)
 {
 	update_sysctl();
+
+	update_runtime_enabled(rq);
 }
 
 static void rq_offline_fair(struct rq *rq)
@@ -5488,7 +5542,8 @@ void init_tg_cfs_entry(struct task_group *tg, struct cfs_rq *cfs_rq,
 		se->cfs_rq = parent->my_q;
 
 	se->my_q = cfs_rq;
-	update_load_set(&se->load, 0);
+	/* guarantee group entities always have weight */
+	update_load_set(&se->load, NICE_0_LOAD);
 	se->parent = parent;
 }
 
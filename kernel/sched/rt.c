@@ -685,8 +685,18 @@ balanced:
 		 * runtime - in which case borrowing doesn't make sense.
 		 */
 		rt_rq->rt_runtime = RUNTIME_INF;
+		if (rt_rq->rt_throttled)
+			rt_rq->rt_throttled_time += rq->clock -
+				rt_rq->rt_throttled_timestamp;
+		rt_rq->rt_throttled = 0;
 		raw_spin_unlock(&rt_rq->rt_runtime_lock);
 		raw_spin_unlock(&rt_b->rt_runtime_lock);
+
+		/*
+		 * Make rt_rq available for pick_next_task(), or migrate_tasks()
+		 * never finds the tasks of a throttled group on a dying cpu.
+		 */
+		sched_rt_rq_enqueue(rt_rq);
 	}
 }
 
@@ -717,6 +727,9 @@ static void __enable_runtime(struct rq *rq)
 		raw_spin_lock(&rt_rq->rt_runtime_lock);
 		rt_rq->rt_runtime = rt_b->rt_runtime;
 		rt_rq->rt_time = 0;
+		if (rt_rq->rt_throttled)
+			rt_rq->rt_throttled_time += rq->clock -
+				rt_rq->rt_throttled_timestamp;
 		rt_rq->rt_throttled = 0;
 		raw_spin_unlock(&rt_rq->rt_runtime_lock);
 		raw_spin_unlock(&rt_b->rt_runtime_lock);
@@ -801,6 +814,8 @@ static int do_sched_rt_period_timer(struct rt_bandwidth *rt_b, int overrun)
 			rt_rq->rt_time -= min(rt_rq->rt_time, overrun*runtime);
 			if (rt_rq->rt_throttled && rt_rq->rt_time < runtime) {
 				rt_rq->rt_throttled = 0;
+				rt_rq->rt_throttled_time += rq->clock -
+					rt_rq->rt_throttled_timestamp;
 				enqueue = 1;
 
 				/*
@@ -856,6 +871,8 @@ static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 
 	if (rt_rq->rt_time > runtime) {
 		rt_rq->rt_throttled = 1;
+		rt_rq->rt_nr_throttled++;
+		rt_rq->rt_throttled_timestamp = rq_of_rt_rq(rt_rq)->clock;
 		printk_once(KERN_WARNING "sched: RT throttling activated\n");
 		if (rt_rq_throttled(rt_rq)) {
 			sched_rt_rq_dequeue(rt_rq);
@@ -1569,6 +1586,21 @@ static struct task_struct *pick_next_pushable_task(struct rq *rq)
 	return p;
 }
 
+/*
+ * A task stays pushable while its group is throttled, but it is not
+ * picked until the group is unthrottled.
+ */
+static int rt_task_throttled(struct task_struct *p)
+{
+	struct sched_rt_entity *rt_se = &p->rt;
+
+	for_each_sched_rt_entity(rt_se) {
+		if (rt_rq_throttled(rt_rq_of_se(rt_se)))
+			return 1;
+	}
+	return 0;
+}
+
 /*
  * If the current CPU has more than one RT task, see if the non
  * running task can migrate over to a CPU that is running a task
@@ -1601,10 +1633,12 @@ retry:
 	/*
 	 * It's possible that the next_task slipped in of
 	 * higher priority than current. If that's the case
-	 * just reschedule current.
+	 * just reschedule current; unless it is throttled, then
+	 * schedule() would pick current again, and again.
 	 */
 	if (unlikely(next_task->prio < rq->curr->prio)) {
-		resched_task(rq->curr);
+		if (!rt_task_throttled(next_task))
+			resched_task(rq->curr);
 		return 0;
 	}
 
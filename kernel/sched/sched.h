@@ -84,7 +84,7 @@ extern struct mutex sched_domains_mutex;
 struct cfs_rq;
 struct rt_rq;
 
-static LIST_HEAD(task_groups);
+extern struct list_head task_groups;
 
 struct cfs_bandwidth {
 #ifdef CONFIG_CFS_BANDWIDTH
@@ -189,6 +189,7 @@ extern int sched_group_set_shares(struct task_group *tg, unsigned long shares);
 extern void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b);
 extern void __start_cfs_bandwidth(struct cfs_bandwidth *cfs_b);
 extern void unthrottle_cfs_rq(struct cfs_rq *cfs_rq);
+extern void sync_throttle(struct task_group *tg, int cpu);
 
 extern void free_rt_sched_group(struct task_group *tg);
 extern int alloc_rt_sched_group(struct task_group *tg, struct task_group *parent);
@@ -312,6 +313,10 @@ struct rt_rq {
 	/* Nests inside the rq lock: */
 	raw_spinlock_t rt_runtime_lock;
 
+	/* statistics */
+	int rt_nr_throttled;
+	u64 rt_throttled_time, rt_throttled_timestamp;
+
 #ifdef CONFIG_RT_GROUP_SCHED
 	unsigned long rt_nr_boosted;
 
@@ -991,6 +996,46 @@ static inline void sched_avg_update(struct rq *rq) { }
 
 extern void start_bandwidth_timer(struct hrtimer *period_timer, ktime_t period);
 
+/*
+ * The code paths that linsched charges rq->lock acquisitions to: the
+ * innermost one that is running when the lock is taken.
+ */
+enum {
+	RQ_LOCK_OTHER,
+	RQ_LOCK_TTWU,		/* try_to_wake_up() */
+	RQ_LOCK_DOUBLE,		/* double_rq_lock() outside the others */
+	RQ_LOCK_BALANCE,	/* load_balance() */
+	RQ_LOCK_NOHZ_BALANCE,	/* nohz_idle_balance() */
+	RQ_LOCK_SHARES,		/* update_shares() */
+	NR_RQ_LOCK_SITES
+};
+
+#ifdef __LINSCHED__
+extern int linsched_rq_lock_site;
+
+static inline int rq_lock_site(void)
+{
+	return linsched_rq_lock_site;
+}
+
+static inline int rq_lock_site_enter(int site)
+{
+	int old = linsched_rq_lock_site;
+
+	linsched_rq_lock_site = site;
+	return old;
+}
+
+static inline void rq_lock_site_exit(int old)
+{
+	linsched_rq_lock_site = old;
+}
+#else
+static inline int rq_lock_site(void) { return RQ_LOCK_OTHER; }
+static inline int rq_lock_site_enter(int site) { return 0; }
+static inline void rq_lock_site_exit(int old) { }
+#endif
+
 #ifdef CONFIG_SMP
 #ifdef CONFIG_PREEMPT
 
@@ -1077,6 +1122,12 @@ static inline void double_rq_lock(struct rq *rq1, struct rq *rq2)
 	__acquires(rq1->lock)
 	__acquires(rq2->lock)
 {
+	/* load_balance() and the like keep their own site */
+	int own_site = rq_lock_site() == RQ_LOCK_OTHER;
+	int site = 0;
+
+	if (own_site)
+		site = rq_lock_site_enter(RQ_LOCK_DOUBLE);
 	BUG_ON(!irqs_disabled());
 	if (rq1 == rq2) {
 		raw_spin_lock(&rq1->lock);
@@ -1090,6 +1141,8 @@ static inline void double_rq_lock(struct rq *rq1, struct rq *rq2)
 			raw_spin_lock_nested(&rq1->lock, SINGLE_DEPTH_NESTING);
 		}
 	}
+	if (own_site)
+		rq_lock_site_exit(site);
 }
 
 /*
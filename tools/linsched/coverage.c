@@ -0,0 +1,56 @@
+/* Coverage feedback for fuzzing
+ *
+ * Objects built with -fsanitize-coverage=trace-pc (COVERAGE=1, see
+ * Makefile.inc) call __sanitizer_cov_trace_pc() at every basic block.
+ * Transitions between consecutive blocks are counted, AFL style, in a
+ * map indexed by a hash of both block addresses, and --coverage <file>
+ * writes the map with the counts bucketed to powers of two when the
+ * test exits (see tests/sched-fuzz).
+ */
+
+#include "linsched.h"
+#include "coverage.h"
+#include <stdio.h>
+
+#define COVERAGE_MAP_SIZE	(1 << 16)
+
+static unsigned char coverage_map[COVERAGE_MAP_SIZE];
+static unsigned long prev_loc;
+
+void __sanitizer_cov_trace_pc(void)
+{
+	/* relative to the text, which moves with every run when PIE */
+	unsigned long loc = (unsigned long)__builtin_return_address(0) -
+			    (unsigned long)__sanitizer_cov_trace_pc;
+
+	loc = (loc ^ (loc >> 16)) * 0x9e3779b1UL;
+	loc = (loc >> 16) & (COVERAGE_MAP_SIZE - 1);
+	if (coverage_map[loc ^ prev_loc] != 0xff)
+		coverage_map[loc ^ prev_loc]++;
+	prev_loc = loc >> 1;
+}
+
+/* 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and 128+ hits are distinct */
+static unsigned char bucket(unsigned char count)
+{
+	if (count < 4)
+		return count;
+	if (count < 32)
+		return 1 << (fls(count) - 1);
+	return count < 128 ? 32 : 128;
+}
+
+/* returns 0, or -1 if the file can't be written */
+int write_coverage(const char *filename)
+{
+	unsigned char buckets[COVERAGE_MAP_SIZE];
+	FILE *f = fopen(filename, "w");
+	int i, ret;
+
+	if (!f)
+		return -1;
+	for (i = 0; i < COVERAGE_MAP_SIZE; i++)
+		buckets[i] = bucket(coverage_map[i]);
+	ret = fwrite(buckets, 1, sizeof(buckets), f) == sizeof(buckets);
+	return fclose(f) || !ret ? -1 : 0;
+}
@@ -0,0 +1,8 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+/* called at every basic block of instrumented objects */
+void __sanitizer_cov_trace_pc(void);
+int write_coverage(const char *filename);
+
+#endif
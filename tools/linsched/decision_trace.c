@@ -0,0 +1,58 @@
+/* Tracing scheduling decisions
+ *
+ * Every context switch is a decision: at this time, on this cpu, this
+ * task replaced that one. The sequence is written to the file given
+ * with --trace_decisions, one "<ns> <cpu> <prev pid> <next pid>" line
+ * per switch, and is summarized by a count and a hash. Two builds
+ * that make the same decisions on the same seeded workload produce
+ * identical traces, so the first differing line is the first point
+ * where a scheduler change made a difference (see tests/ab-run).
+ */
+
+#include "linsched.h"
+#include "decision_trace.h"
+#include <stdio.h>
+
+static FILE *trace_file;
+static u64 nr_decisions;
+/* FNV-1a over the decision sequence */
+static u64 decision_hash = 0xcbf29ce484222325ULL;
+
+static void hash_u64(u64 v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++, v >>= 8) {
+		decision_hash ^= v & 0xff;
+		decision_hash *= 0x100000001b3ULL;
+	}
+}
+
+/* returns 0, or -1 if the file can't be written */
+int open_decision_trace(const char *filename)
+{
+	trace_file = fopen(filename, "w");
+	return trace_file ? 0 : -1;
+}
+
+void trace_switch_decision(struct task_struct *prev, struct task_struct *next)
+{
+	int cpu = smp_processor_id();
+
+	nr_decisions++;
+	hash_u64(current_time);
+	hash_u64(cpu);
+	hash_u64(prev->pid);
+	hash_u64(next->pid);
+	if (trace_file)
+		fprintf(trace_file, "%llu %d %d %d\n", current_time, cpu,
+			prev->pid, next->pid);
+}
+
+void print_decision_stats(void)
+{
+	if (trace_file)
+		fflush(trace_file);
+	printf("decisions: %llu, hash = %016llx\n", nr_decisions,
+	       decision_hash);
+}
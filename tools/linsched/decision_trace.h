@@ -0,0 +1,9 @@
+#ifndef DECISION_TRACE_H
+#define DECISION_TRACE_H
+
+/* called on every context switch, from switch_to() */
+void trace_switch_decision(struct task_struct *prev, struct task_struct *next);
+int open_decision_trace(const char *filename);
+void print_decision_stats(void);
+
+#endif
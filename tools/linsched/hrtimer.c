@@ -28,7 +28,10 @@
 
 #include "load_balance_score.h"
 #include "nohz_tracking.h"
+#include "rq_lock_tracking.h"
 #include "sanity_check.h"
+#include "sim_profile.h"
+#include "linsched_scenario.h"
 
 static int linsched_hrt_set_next_event(unsigned long evt,
 				       struct clock_event_device *d);
@@ -71,20 +74,28 @@ static struct clocksource linsched_hrt_source = {
 	.read = linsched_source_read,
 };
 
+/* registers the clock event device of the current cpu, at boot and
+ * again when it comes back online */
+void linsched_init_clockevent(void)
+{
+	int cpu = smp_processor_id();
+	struct clock_event_device *dev = &linsched_hrt[cpu];
+
+	memcpy(dev, &linsched_hrt_base, sizeof(struct clock_event_device));
+	dev->cpumask = cpumask_of(cpu);
+
+	next_event[cpu] = KTIME_MAX;
+
+	clockevents_register_device(dev);
+}
+
 void linsched_init_hrtimer(void)
 {
 	long i;
 
 	for (i = 0; i < nr_cpu_ids; i++) {
-		struct clock_event_device *dev = &linsched_hrt[i];
-		memcpy(dev, &linsched_hrt_base,
-		       sizeof(struct clock_event_device));
-		dev->cpumask = cpumask_of(i);
-
-		next_event[i] = KTIME_MAX;
-
 		linsched_change_cpu(i);
-		clockevents_register_device(dev);
+		linsched_init_clockevent();
 	}
 	/* Normally this would be called when looking through
 	 * clocksources, but we're not using the entire clocksource
@@ -101,6 +112,7 @@ void linsched_current_handler(void)
 {
 	struct task_struct *old;
 
+	sim_profile_enter(PHASE_TASKS);
 	do {
 		struct task_data *td = task_thread_info(current)->td;
 		old = current;
@@ -112,6 +124,7 @@ void linsched_current_handler(void)
 		 * can have smaller than clock gran runtimes if they want */
 		linsched_check_resched();
 	} while (current != old);
+	sim_profile_exit();
 
 	/* we should always be done by this point */
 	BUG_ON(need_resched());
@@ -193,6 +206,8 @@ void linsched_run_sim(int sim_ticks)
 	cpumask_t runnable;
 	int i;
 
+	sim_profile_start();
+	start_rq_lock_tracking();
 	for_each_online_cpu(i) {
 		linsched_change_cpu(i);
 		linsched_current_handler();
@@ -215,7 +230,9 @@ void linsched_run_sim(int sim_ticks)
 		current_time = evt;
 		int active_cpu = 0;
 
+		sim_profile_enter(PHASE_LB_INFO);
 		compute_lb_info();
+		sim_profile_exit();
 
 		/* It might be useful to randomize the ordering here, although
 		 * it should be rare that there will actually be two active
@@ -224,18 +241,28 @@ void linsched_run_sim(int sim_ticks)
 		for_each_cpu(active_cpu, &runnable) {
 			next_event[active_cpu] = KTIME_MAX;
 			linsched_change_cpu(active_cpu);
+			sim_profile_event();
+			sim_profile_enter(PHASE_EVENT_HANDLER);
 			local_irq_disable();
 			irq_enter();
 			linsched_hrt[active_cpu].event_handler(&linsched_hrt
 							       [active_cpu]);
 			irq_exit();
 			local_irq_enable();
+			sim_profile_exit();
 			/* a handler should never leave this state changed */
 			BUG_ON(smp_processor_id() != active_cpu);
 
+			sim_profile_enter(PHASE_RCU);
 			linsched_rcu_invoke();
+			sim_profile_exit();
+			sim_profile_enter(PHASE_SCENARIO);
+			linsched_scenario_process();
+			sim_profile_exit();
 
+			sim_profile_enter(PHASE_RESCHED);
 			process_pending_resched();
+			sim_profile_exit();
 			linsched_check_idle_cpu();
 
 			BUG_ON(irqs_disabled());
@@ -245,10 +272,15 @@ void linsched_run_sim(int sim_ticks)
 				linsched_current_handler();
 			}
 
+			sim_profile_enter(PHASE_NOHZ);
 			track_nohz_residency(active_cpu);
+			sim_profile_exit();
+			sim_profile_enter(PHASE_SANITY);
 			run_sanity_check();
+			sim_profile_exit();
 		}
 	}
+	sim_profile_stop();
 }
 
 struct clocksource *__init __weak clocksource_default_clock(void)
@@ -265,9 +297,24 @@ static int linsched_hrt_set_next_event(unsigned long evt,
 	return 0;
 }
 
+/*
+ * Makes the clock event device of cpu fire by when at the latest. An
+ * idle cpu can keep an expired tick timer queued with its device set
+ * to a later time, and a timer queued behind it then does not
+ * reprogram the device; IPIs use this to be delivered on time.
+ */
+void linsched_program_cpu_event(int cpu, u64 when)
+{
+	if (when < next_event[cpu])
+		next_event[cpu] = when;
+}
+
 static void linsched_hrt_set_mode(enum clock_event_mode mode,
 				  struct clock_event_device *d)
 {
+	/* a device released by an offline cpu must not fire */
+	if (mode == CLOCK_EVT_MODE_SHUTDOWN || mode == CLOCK_EVT_MODE_UNUSED)
+		next_event[d - linsched_hrt] = KTIME_MAX;
 }
 
 static void linsched_hrt_broadcast(const struct cpumask *mask)
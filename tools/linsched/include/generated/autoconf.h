@@ -221,6 +221,10 @@
 #define CONFIG_CGROUP_SCHED 1
 #define CONFIG_CGROUP_CPUACCT 1
 #define CONFIG_FAIR_GROUP_SCHED 1
+#define CONFIG_CFS_BANDWIDTH 1
+#define CONFIG_RT_GROUP_SCHED 1
+#define CONFIG_SCHED_AUTOGROUP 1
+#define CONFIG_IRQ_TIME_ACCOUNTING 1
 #define CONFIG_SCHEDSTATS 1
 #define CONFIG_X86 1
 #define CONFIG_X86_CPUID 1
@@ -0,0 +1,151 @@
+/* Tracking scheduling latency
+ *
+ * Every time a task is switched in, the time it spent waiting on the
+ * runqueue (as added to sched_info.run_delay) is recorded, either as
+ * wakeup latency if the task was woken since it last ran, or as
+ * preemption latency if it was still runnable. Latencies are kept in
+ * log-linear histograms, overall and per task group.
+ */
+
+#include "linsched.h"
+#include "latency_tracking.h"
+#include <stdio.h>
+#include <malloc.h>
+
+/* 16 linear buckets per power of two, so percentiles are within ~6% */
+#define SUB_BITS 4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define NR_BUCKETS ((64 - SUB_BITS) * SUB_BUCKETS)
+
+struct latency_hist {
+	u64 count, sum, max;
+	u64 buckets[NR_BUCKETS];
+};
+
+/* [0] is wakeup latency, [1] preemption latency */
+static struct latency_hist overall[2];
+static struct latency_hist *group_hist[LINSCHED_MAX_GROUPS][2];
+
+static int bucket_of(u64 v)
+{
+	int shift;
+
+	if (v < 2 * SUB_BUCKETS)
+		return v;
+	shift = fls64(v) - 1 - SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + (v >> shift) - SUB_BUCKETS;
+}
+
+/* the middle of the range of values in bucket b */
+static u64 bucket_value(int b)
+{
+	int shift;
+
+	if (b < 2 * SUB_BUCKETS)
+		return b;
+	shift = b / SUB_BUCKETS - 1;
+	return ((u64)(SUB_BUCKETS + b % SUB_BUCKETS) << shift) +
+		(1ULL << shift) / 2;
+}
+
+static void hist_add(struct latency_hist *h, u64 v)
+{
+	h->count++;
+	h->sum += v;
+	if (v > h->max)
+		h->max = v;
+	h->buckets[bucket_of(v)]++;
+}
+
+static u64 hist_percentile(struct latency_hist *h, double pct)
+{
+	u64 rank, seen = 0;
+	int b;
+
+	if (!h->count)
+		return 0;
+	rank = h->count * pct / 100;
+	if (rank >= h->count)
+		return h->max;
+	for (b = 0; b < NR_BUCKETS; b++) {
+		seen += h->buckets[b];
+		if (seen > rank)
+			return min(bucket_value(b), h->max);
+	}
+	return h->max;
+}
+
+void track_switch_latency(struct task_struct *prev, struct task_struct *next)
+{
+	struct thread_info *ti = task_thread_info(next);
+	struct linsched_cgroup *lcg;
+	u64 delay;
+	int wakeup, id;
+
+	if (is_idle_task(next) || next->sched_class == &stop_sched_class)
+		return;
+
+	/* sched_info_arrive() has just accounted the wait in run_delay */
+	delay = next->sched_info.run_delay - ti->lat_run_delay;
+	wakeup = next->se.statistics.nr_wakeups != ti->lat_nr_wakeups;
+	ti->lat_run_delay = next->sched_info.run_delay;
+	ti->lat_nr_wakeups = next->se.statistics.nr_wakeups;
+
+	hist_add(&overall[!wakeup], delay);
+
+	if (!task_group(next)->css.cgroup)
+		return;
+	lcg = linsched_tg(task_group(next));
+	id = lcg - __linsched_cgroups;
+	if (id < 0 || id >= LINSCHED_MAX_GROUPS)
+		return;
+	if (!group_hist[id][!wakeup]) {
+		group_hist[id][!wakeup] = calloc(1, sizeof(struct latency_hist));
+		BUG_ON(!group_hist[id][!wakeup]);
+	}
+	hist_add(group_hist[id][!wakeup], delay);
+}
+
+/* returns the pct percentile of wakeup (or preemption) latency in ns */
+u64 latency_percentile(int wakeup, double pct)
+{
+	return hist_percentile(&overall[!wakeup], pct);
+}
+
+/* the number and sum of wakeup (or preemption) latencies so far */
+void latency_totals(int wakeup, u64 *count, u64 *sum)
+{
+	*count = overall[!wakeup].count;
+	*sum = overall[!wakeup].sum;
+}
+
+static void print_hist(const char *name, struct latency_hist *h)
+{
+	if (!h || !h->count)
+		return;
+	printf("%s: count = %llu, mean = %llu, p50 = %llu, p90 = %llu, "
+	       "p99 = %llu, p99.9 = %llu, max = %llu\n", name, h->count,
+	       h->sum / h->count, hist_percentile(h, 50),
+	       hist_percentile(h, 90), hist_percentile(h, 99),
+	       hist_percentile(h, 99.9), h->max);
+}
+
+void print_latency_stats(void)
+{
+	extern int num_cgroups;
+	char buf[128], name[160];
+	int i;
+
+	printf("Latencies in ns:\n");
+	print_hist("wakeup", &overall[0]);
+	print_hist("preempt", &overall[1]);
+	for (i = 0; i < num_cgroups; i++) {
+		if (!group_hist[i][0] && !group_hist[i][1])
+			continue;
+		cgroup_path(&__linsched_cgroups[i].cg, buf, sizeof(buf));
+		snprintf(name, sizeof(name), "%s wakeup", buf);
+		print_hist(name, group_hist[i][0]);
+		snprintf(name, sizeof(name), "%s preempt", buf);
+		print_hist(name, group_hist[i][1]);
+	}
+}
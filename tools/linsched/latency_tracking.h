@@ -0,0 +1,10 @@
+#ifndef LATENCY_TRACKING_H
+#define LATENCY_TRACKING_H
+
+/* called on every context switch, from switch_to() */
+void track_switch_latency(struct task_struct *prev, struct task_struct *next);
+void print_latency_stats(void);
+u64 latency_percentile(int wakeup, double pct);
+void latency_totals(int wakeup, u64 *count, u64 *sum);
+
+#endif
@@ -1,6 +1,12 @@
 #include "linsched.h"
 #include "nohz_tracking.h"
+#include "rq_lock_tracking.h"
+#include "latency_tracking.h"
+#include "decision_trace.h"
+#include "coverage.h"
 #include "load_balance_score.h"
+#include "sanity_check.h"
+#include "sim_profile.h"
 
 #include <stdio.h>
 #include <getopt.h>
@@ -16,6 +22,41 @@ static void print_global_usage(void)
 	printf("\t\t --print_cgroup_stats: print cgroup runtime stats\n");
 	printf("\t\t --print_nohz_stats: print nohz residency information\n");
 	printf("\t\t --print_average_imbalance: print average balance stats\n");
+	printf("\t\t --print_bandwidth_stats: print cfs bandwidth "
+	       "throttling stats\n");
+	printf("\t\t --print_rt_stats: print rt group throttling stats\n");
+	printf("\t\t --print_latency_stats: print wakeup and preemption "
+	       "latency percentiles\n");
+	printf("\t\t --print_decisions: print the number and a hash of "
+	       "scheduling decisions\n");
+	printf("\t\t --trace_decisions <file>: write every context switch "
+	       "to file\n");
+	printf("\t\t --coverage <file>: write the coverage map of objects "
+	       "built with COVERAGE=1 at exit\n");
+	printf("\t\t --profile_sim: print the host cycles spent in each "
+	       "phase of the simulation\n");
+	printf("\t\t --profile_sim_interval <n>: profile one event in n "
+	       "[default: 8]\n");
+	printf("\t\t --sanity_check <off|sampled|local|global>: "
+	       "invariants checked after events [default: local]\n");
+	printf("\t\t --sanity_check_interval <n>: events between "
+	       "sampled checks [default: 64]\n");
+	printf("\t\t --print_sanity_stats: print the time spent in "
+	       "each check\n");
+	printf("\t\t --sysctl <name>=<value>: set a scheduler sysctl, "
+	       "e.g. sched_latency_ns=12000000\n");
+	printf("\t\t --sched_feat [NO_]<feature>: set or clear a "
+	       "SCHED_FEAT bit\n");
+	printf("\t\t --ipi_latency <smt>,<llc>,<node>: ns an IPI takes "
+	       "to reach a cpu at each distance [default: instant]\n");
+	printf("\t\t --ipi_cost <ns>: irq time an IPI costs its "
+	       "target\n");
+	printf("\t\t --print_ipi_stats: print IPI counts and "
+	       "latencies\n");
+	printf("\t\t --rq_lock_window <ns>: track rq->lock contention, "
+	       "each acquisition holding the lock for ns\n");
+	printf("\t\t --print_rq_lock_stats: print rq->lock contention "
+	       "per rq and per code path\n");
 	printf("\t\t --dump_imbalance: print imbalance every step\n");
 	printf("\t\t --dump_full_balance: print full load balance info"
 	       "every step\n");
@@ -37,6 +78,24 @@ void linsched_process_global_options(int *argc, char **argv)
 		{"print_sched_stats", no_argument, &opt->print_sched_stats, 1},
 		{"dump_imbalance", no_argument, &opt->dump_imbalance, 1},
 		{"dump_full_balance", no_argument, &opt->dump_full_balance, 1},
+		{"print_bandwidth_stats", no_argument, &opt->print_bandwidth, 1},
+		{"print_rt_stats", no_argument, &opt->print_rt, 1},
+		{"print_latency_stats", no_argument, &opt->print_latency, 1},
+		{"print_decisions", no_argument, &opt->print_decisions, 1},
+		{"trace_decisions", required_argument, NULL, 'D'},
+		{"coverage", required_argument, NULL, 'C'},
+		{"sanity_check", required_argument, NULL, 'S'},
+		{"sanity_check_interval", required_argument, NULL, 'I'},
+		{"print_sanity_stats", no_argument, &opt->print_sanity, 1},
+		{"profile_sim", no_argument, &opt->profile_sim, 1},
+		{"profile_sim_interval", required_argument, NULL, 'P'},
+		{"sysctl", required_argument, NULL, 'y'},
+		{"sched_feat", required_argument, NULL, 'F'},
+		{"ipi_latency", required_argument, NULL, 'L'},
+		{"ipi_cost", required_argument, NULL, 'K'},
+		{"print_ipi_stats", no_argument, &opt->print_ipi, 1},
+		{"rq_lock_window", required_argument, NULL, 'W'},
+		{"print_rq_lock_stats", no_argument, &opt->print_rq_lock, 1},
 		{0, 0, 0, 0}
 	};
 
@@ -45,15 +104,69 @@ void linsched_process_global_options(int *argc, char **argv)
 		c = getopt_long(*argc, argv, "-", long_options, &idx);
 		if (c == 'V') {
 			print_global_usage();
-		} else if (c == 0) {
+		} else if (c == 0 || c == 'y' || c == 'F' || c == 'D' ||
+			   c == 'C' || c == 'S' || c == 'I' || c == 'P' ||
+			   c == 'L' || c == 'K' || c == 'W') {
+			/* "--opt arg" takes two args, "--opt=arg" one */
+			int n = (c != 0 && optarg == argv[optind - 1]) ? 2 : 1;
+
+			if (c == 'y' && opt->n_sysctls < LINSCHED_MAX_TUNABLES)
+				opt->sysctls[opt->n_sysctls++] = optarg;
+			if (c == 'F' &&
+			    opt->n_sched_feats < LINSCHED_MAX_TUNABLES)
+				opt->sched_feats[opt->n_sched_feats++] = optarg;
+			if (c == 'D') {
+				if (open_decision_trace(optarg)) {
+					perror(optarg);
+					exit(1);
+				}
+				opt->print_decisions = 1;
+			}
+			if (c == 'C')
+				opt->coverage_file = optarg;
+			if (c == 'S' && set_sanity_check_level(optarg)) {
+				fprintf(stderr, "unknown sanity check level "
+					"%s\n", optarg);
+				exit(1);
+			}
+			if (c == 'I') {
+				sanity_check_interval = atoi(optarg);
+				if (sanity_check_interval < 1) {
+					fprintf(stderr, "bad sanity check "
+						"interval %s\n", optarg);
+					exit(1);
+				}
+			}
+			if (c == 'L' && linsched_set_ipi_latency(optarg)) {
+				fprintf(stderr, "bad ipi latency %s\n",
+					optarg);
+				exit(1);
+			}
+			if (c == 'K')
+				linsched_set_ipi_cost(strtoull(optarg, NULL,
+							       0));
+			if (c == 'W' && set_rq_lock_window(optarg)) {
+				fprintf(stderr, "bad rq lock window %s\n",
+					optarg);
+				exit(1);
+			}
+			if (c == 'P') {
+				sim_profile_interval = atoi(optarg);
+				if (sim_profile_interval < 1) {
+					fprintf(stderr, "bad profile "
+						"interval %s\n", optarg);
+					exit(1);
+				}
+			}
 			/*
 			 * pull opt out of args so that it doesn't confuse
 			 * other handlers or cause false negatives (e.g.
 			 * invalid argument).
 			 */
-			for (i = --optind; i < *argc; i++)
-				argv[i] = argv[i+1];
-			(*argc)--;
+			optind -= n;
+			for (i = optind; i + n <= *argc; i++)
+				argv[i] = argv[i + n];
+			*argc -= n;
 		} else if (c == -1)
 			break;
 	}
@@ -85,6 +198,22 @@ int main(int argc, char **argv)
 		stat_header("group runtime");
 		linsched_print_group_stats();
 	}
+	if (linsched_global_options.print_bandwidth) {
+		stat_header("bandwidth");
+		linsched_print_bandwidth_stats();
+	}
+	if (linsched_global_options.print_rt) {
+		stat_header("rt bandwidth");
+		linsched_print_rt_stats();
+	}
+	if (linsched_global_options.print_latency) {
+		stat_header("latency");
+		print_latency_stats();
+	}
+	if (linsched_global_options.print_decisions) {
+		stat_header("decisions");
+		print_decision_stats();
+	}
 	if (linsched_global_options.print_sched_stats) {
 		stat_header("sched stats");
 		linsched_show_schedstat();
@@ -93,8 +222,29 @@ int main(int argc, char **argv)
 		stat_header("nohz residency");
 		print_nohz_residency();
 	}
+	if (linsched_global_options.print_ipi) {
+		stat_header("ipi");
+		linsched_print_ipi_stats();
+	}
+	if (linsched_global_options.print_rq_lock) {
+		stat_header("rq lock");
+		print_rq_lock_stats();
+	}
+	if (linsched_global_options.print_sanity) {
+		stat_header("sanity check");
+		print_sanity_check_stats();
+	}
+	if (linsched_global_options.profile_sim) {
+		stat_header("sim profile");
+		print_sim_profile();
+	}
 	if (linsched_global_options.print_avg_imb) {
 		printf("average imbalance: %f\n", get_average_imbalance());
 	}
+	if (linsched_global_options.coverage_file &&
+	    write_coverage(linsched_global_options.coverage_file)) {
+		perror(linsched_global_options.coverage_file);
+		ret = 1;
+	}
 	return ret;
 }
@@ -25,7 +25,7 @@
 /* Linsched definitions and declarations. */
 #define LINSCHED_RAND_SEED	123456
 #define LINSCHED_MAX_TASKS	10000
-#define LINSCHED_MAX_GROUPS	100
+#define LINSCHED_MAX_GROUPS	1000
 #define LINSCHED_DEFAULT_NR_CPUS 4
 
 /* have we started the simulation */
@@ -82,12 +82,18 @@ struct rnd_dist_task {
 	struct rand_dist *sleep_rdist, *busy_rdist;
 };
 
+struct linsched_io_dev;
+struct linsched_io_req;
+
 struct perf_task {
 	struct sleep_run_data sr_data;
 	unsigned int busy;	/* ms to run */
 	unsigned int sleep;	/* ms to sleep */
 	char *filename;		/* pid.rlog file */
 	void *fp;		/* fp to pid.rlog file */
+	/* where IOWAIT events go, fixed sleeps without */
+	struct linsched_io_dev *io_dev;
+	struct linsched_io_req *io_req;
 };
 
 enum linsched_perf_event_type {
@@ -318,6 +324,8 @@ enum topologies {
 		},						\
 	}
 
+#define LINSCHED_MAX_TUNABLES 64
+
 struct linsched_global_options {
 	int print_nohz;
 	int print_tasks;
@@ -326,6 +334,19 @@ struct linsched_global_options {
 	int print_sched_stats;
 	int dump_imbalance;
 	int dump_full_balance;
+	int print_bandwidth;
+	int print_rt;
+	int print_latency;
+	int print_decisions;
+	int print_sanity;
+	int profile_sim;
+	int print_ipi;
+	int print_rq_lock;
+	char *coverage_file;
+	char *sysctls[LINSCHED_MAX_TUNABLES];
+	int n_sysctls;
+	char *sched_feats[LINSCHED_MAX_TUNABLES];
+	int n_sched_feats;
 };
 extern struct linsched_global_options linsched_global_options;
 
@@ -342,10 +363,15 @@ struct task_group *cgroup_tg(struct cgroup *cgrp);
 struct cpuacct *cgroup_ca(struct cgroup *cgrp);
 struct cpuacct *task_ca(struct task_struct *tsk);
 struct task_group *task_group(struct task_struct *p);
+int tg_set_cfs_quota(struct task_group *tg, long cfs_quota_us);
+long tg_get_cfs_quota(struct task_group *tg);
+int tg_set_cfs_period(struct task_group *tg, long cfs_period_us);
+long tg_get_cfs_period(struct task_group *tg);
 
 /* cgroup functions */
 const char *cgroup_name(struct cgroup *cgrp);
 struct cgroup *linsched_create_cgroup(struct cgroup *parent, char *path);
+struct cgroup *linsched_find_cgroup(const char *path, int create);
 struct task_group *cgroup_tg(struct cgroup *cgrp); /* from sched.c */
 struct cpuacct *cgroup_ca(struct cgroup *cgrp); /* from sched.c */
 struct cpuacct *task_ca(struct task_struct *tsk); /* from sched.c */
@@ -362,18 +388,41 @@ static inline struct linsched_cgroup *linsched_tg(struct task_group *tg) {
 
 struct task_struct *linsched_get_task(int task_id);
 struct task_data *linsched_create_sleep_run(int sleep, int busy);
+/* building blocks of the sleep / run task models, for other models */
+void sleep_run_init(struct sleep_run_data *d);
+void sleep_run_start(struct task_struct *p, void *data);
+void sleep_run_sleep_for(struct sleep_run_data *d, int state, u64 ns);
+int sleep_run_run_for(struct sleep_run_data *d, u64 ns);
 struct task_struct *linsched_create_batch_task(struct task_data *, int niceval);
 struct task_struct *linsched_create_RTfifo_task(struct task_data *, int prio);
 struct task_struct *linsched_create_RTrr_task(struct task_data *, int prio);
 struct task_struct *linsched_create_normal_task(struct task_data *td, int niceval);
+void linsched_exit_task(struct task_struct *p);
+int linsched_task_ids_left(void);
 
 struct task_struct *linsched_raw_copy_process(void);
 int linsched_show_schedstat(void);
 void linsched_change_cpu(int cpu);
 void linsched_trigger_cpu(int cpu);
+
+/* how far an IPI travels, see numa.c */
+enum {
+	IPI_SMT,
+	IPI_LLC,
+	IPI_NODE,
+	IPI_REMOTE,
+	IPI_NR_DISTANCES
+};
+int linsched_set_ipi_latency(const char *arg);
+void linsched_set_ipi_cost(u64 ns);
+u64 linsched_ipi_delay(int cpu);
+void linsched_print_ipi_stats(void);
+
 void linsched_check_resched(void);
 void linsched_init_cpus(struct linsched_topology *topo);
 void linsched_init_hrtimer(void);
+void linsched_init_clockevent(void);
+void linsched_program_cpu_event(int cpu, u64 when);
 void linsched_init(struct linsched_topology *topo);
 void linsched_default_callback(void);
 void linsched_announce_callback(void);
@@ -384,6 +433,11 @@ int linsched_force_migration(struct task_struct *task, int dest_cpu, int migr);
 int linsched_create_task_group(int parent);
 int linsched_add_task_to_group(struct task_struct *p, struct cgroup *cgrp);
 void linsched_set_task_group_shares(int groupid, unsigned long shares);
+int linsched_set_task_group_bandwidth(struct cgroup *cgrp, long period_us,
+				      long quota_us);
+int linsched_set_task_group_rt_runtime(struct cgroup *cgrp, long period_us,
+				       long runtime_us);
+struct cgroup *linsched_create_autogroup(struct task_struct *p);
 void linsched_yield(void);
 void linsched_random_init(int seed);
 unsigned long linsched_random(void);
@@ -391,6 +445,17 @@ void linsched_run_sim(int sim_ticks);
 void linsched_sched_debug_show(void);
 void linsched_print_task_stats(void);
 void linsched_print_group_stats(void);
+void linsched_print_bandwidth_stats(void);
+void linsched_print_rt_stats(void);
+int linsched_set_sysctl(const char *name, const char *value);
+int linsched_set_sched_feat(const char *name);
+void linsched_apply_global_tunables(void);
+u64 task_exec_time(struct task_struct *p);
+u64 group_exec_time(struct task_group *tg);
+
+/* in kernel/sched/core.c */
+void linsched_account_irq_time(int cpu, u64 hardirq, u64 softirq);
+u64 linsched_rq_clock_task(int cpu);
 
 void linsched_print_cpuacct_stats(int cpuacct_group_id);
 void linsched_runtime_timer(struct task_struct *t, u64 runtime, void (*fn)(struct task_data *));
@@ -398,7 +463,7 @@ void linsched_idled_set(int cpu, long idle_time, long busy_time);
 struct task_data *linsched_create_rnd_dist_sleep_run(struct rand_dist *sleep_rdist,
                                                      struct rand_dist *busy_rdist);
 u64 getticks(void);
-int linsched_create_perf_tasks(char *dirpath);
+int linsched_create_perf_tasks(char *dirpath, struct linsched_io_dev *io_dev);
 
 void linsched_set_printk_level(int level);
 
@@ -0,0 +1,335 @@
+/* Fork / exit churn for linsched, see linsched_churn.h */
+
+#include "linsched.h"
+#include "linsched_churn.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+enum spawner_state {
+	SPAWNER_IDLE,		/* about to start on the next fork */
+	SPAWNER_FORK,		/* running the cost of a fork */
+	SPAWNER_SLEEP,		/* forked, about to sleep */
+};
+
+struct churn_spawner {
+	struct sleep_run_data sr_data;
+	struct linsched_churn *ch;
+	enum spawner_state state;
+	u64 cost;
+};
+
+struct churn_child {
+	struct sleep_run_data sr_data;
+	struct linsched_churn *ch;
+	struct task_data *td;
+	struct list_head list;
+	u64 forked, lifetime;
+	int fork_cpu, ran;
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+static void add_sample(u64 **samples, u64 *n, u64 *max, u64 v)
+{
+	if (*n == *max) {
+		*max = max(2 * *max, 1024ULL);
+		*samples = realloc(*samples, *max * sizeof(u64));
+		BUG_ON(!*samples);
+	}
+	(*samples)[(*n)++] = v;
+}
+
+static void churn_child_start(struct task_struct *p, void *data)
+{
+	struct churn_child *c = data;
+
+	sleep_run_start(p, &c->sr_data);
+}
+
+static void churn_child_handle(struct task_struct *p, void *data)
+{
+	struct churn_child *c = data;
+	struct linsched_churn *ch = c->ch;
+	int cpu = task_cpu(p);
+
+	if (!c->ran) {
+		c->ran = 1;
+		add_sample(&ch->first_run, &ch->n_first_run,
+			   &ch->max_first_run, current_time - c->forked);
+		if (cpu == c->fork_cpu)
+			ch->first_run_same_cpu++;
+		else if (cpumask_test_cpu(cpu, cpu_coregroup_mask(c->fork_cpu)))
+			ch->first_run_same_llc++;
+		else
+			ch->first_run_remote++;
+	}
+
+	if (!sleep_run_run_for(&c->sr_data, c->lifetime))
+		return;
+
+	add_sample(&ch->turnaround, &ch->n_turnaround, &ch->max_turnaround,
+		   current_time - c->forked);
+	ch->exited++;
+	ch->alive--;
+	list_del(&c->list);
+
+	/* the task_struct goes away, and the timer with it */
+	hrtimer_cancel(&c->sr_data.timer);
+	linsched_exit_task(p);
+	free(c->td);
+	free(c);
+}
+
+/* forks a child of current, which inherits its cgroup and cpus */
+static void churn_fork(struct linsched_churn *ch)
+{
+	struct churn_child *c;
+	struct task_data *td;
+
+	/* leave some task ids for whoever else creates tasks */
+	if (linsched_task_ids_left() <= 1) {
+		ch->refused++;
+		return;
+	}
+
+	c = calloc(1, sizeof(*c));
+	td = malloc(sizeof(*td));
+	BUG_ON(!c || !td);
+	c->ch = ch;
+	c->td = td;
+	c->lifetime = gen_ns(ch->lifetime);
+	c->forked = current_time;
+	c->fork_cpu = smp_processor_id();
+	sleep_run_init(&c->sr_data);
+	td->data = c;
+	td->init_task = churn_child_start;
+	td->handle_task = churn_child_handle;
+	list_add_tail(&c->list, &ch->children);
+
+	ch->spawned++;
+	ch->max_alive = max(ch->max_alive, ++ch->alive);
+	set_cpus_allowed_ptr(linsched_create_normal_task(td, 0), ch->cpus);
+}
+
+static void churn_spawner_handle(struct task_struct *p, void *data)
+{
+	struct churn_spawner *s = data;
+	struct linsched_churn *ch = s->ch;
+
+	if (s->state == SPAWNER_IDLE) {
+		s->cost = gen_ns(ch->cost);
+		s->state = SPAWNER_FORK;
+	}
+
+	if (s->state == SPAWNER_FORK) {
+		if (!sleep_run_run_for(&s->sr_data, s->cost))
+			return;
+		s->state = SPAWNER_SLEEP;
+		churn_fork(ch);
+		/* the child preempted us, sleep once we run again */
+		if (current != p)
+			return;
+	}
+
+	s->state = SPAWNER_IDLE;
+	sleep_run_sleep_for(&s->sr_data, TASK_INTERRUPTIBLE,
+			    max(gen_ns(ch->interval), 1ULL));
+}
+
+static int parse_churn_line(struct linsched_churn *ch, char *line,
+			    unsigned int *rand_state)
+{
+	char path[128] = "";
+	int n;
+
+	if (sscanf(line, "SPAWNERS %d %127s", &n, path) >= 1) {
+		if (n <= 0 || (path[0] && path[0] != '/'))
+			return -1;
+		ch->n_spawners = n;
+		ch->cg = path[0] ? linsched_find_cgroup(path, 1) : root_cgroup;
+	} else if (!strncmp(line, "INTERVAL ", 9)) {
+		line += 9;
+		ch->interval = linsched_parse_distribution(&line, rand_state);
+		return ch->interval ? 0 : -1;
+	} else if (!strncmp(line, "FORK_COST ", 10)) {
+		line += 10;
+		ch->cost = linsched_parse_distribution(&line, rand_state);
+		return ch->cost ? 0 : -1;
+	} else if (!strncmp(line, "LIFETIME ", 9)) {
+		line += 9;
+		ch->lifetime = linsched_parse_distribution(&line, rand_state);
+		return ch->lifetime ? 0 : -1;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/* Creates the spawners described by a file of lines
+ *   SPAWNERS <n> [<cgroup>]
+ *   INTERVAL <dist of the time a spawner sleeps between forks>
+ *   FORK_COST <dist of the cpu time a spawner spends per fork>
+ *   LIFETIME <dist of the cpu time a child runs before exiting>
+ * where distributions are in ns, as in linsched_create_sim(), and
+ * all lines are required. The spawners are nice 0 tasks in cgroup
+ * (the root by default), and so are the children they fork. Empty
+ * lines and lines starting with '#' are ignored. */
+struct linsched_churn *linsched_load_churn(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state)
+{
+	struct linsched_churn *ch = calloc(1, sizeof(*ch));
+	char line[256];
+	FILE *f;
+	int i, lineno = 0;
+
+	BUG_ON(!ch);
+	ch->cpus = cpus;
+	INIT_LIST_HEAD(&ch->children);
+
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_churn_line(ch, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad churn line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!ch->n_spawners || !ch->interval || !ch->cost || !ch->lifetime) {
+		fprintf(stderr, "%s: churn needs SPAWNERS, INTERVAL, "
+			"FORK_COST and LIFETIME\n", filename);
+		goto err;
+	}
+
+	ch->spawners = calloc(ch->n_spawners, sizeof(struct task_struct *));
+	BUG_ON(!ch->spawners);
+	for (i = 0; i < ch->n_spawners; i++) {
+		struct task_data *td = malloc(sizeof(struct task_data));
+		struct churn_spawner *s = calloc(1, sizeof(*s));
+
+		BUG_ON(!td || !s);
+		s->ch = ch;
+		sleep_run_init(&s->sr_data);
+		td->data = s;
+		td->init_task = sleep_run_start;
+		td->handle_task = churn_spawner_handle;
+		ch->spawners[i] = linsched_create_normal_task(td, 0);
+		set_cpus_allowed_ptr(ch->spawners[i], cpus);
+		linsched_add_task_to_group(ch->spawners[i], ch->cg);
+	}
+
+	ch->start = current_time;
+	return ch;
+
+err:
+	linsched_destroy_churn(ch);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print_latencies(const char *name, u64 *samples, u64 n)
+{
+	u64 sum = 0, i;
+
+	qsort(samples, n, sizeof(u64), u64_compare);
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+
+	fprintf(stdout, "%s (us): mean = %.1f", name,
+		n ? sum / 1000.0 / n : 0);
+	if (n)
+		fprintf(stdout, ", p50 = %.1f, p90 = %.1f, p99 = %.1f, "
+			"max = %.1f", samples[n / 2] / 1000.0,
+			samples[min(n * 90 / 100, n - 1)] / 1000.0,
+			samples[min(n * 99 / 100, n - 1)] / 1000.0,
+			samples[n - 1] / 1000.0);
+	fprintf(stdout, "\n");
+}
+
+void linsched_print_churn_report(struct linsched_churn *ch)
+{
+	double secs = (current_time - ch->start) / (double)NSEC_PER_SEC;
+	double w = ch->n_first_run ? 100.0 / ch->n_first_run : 0;
+	char buf[128];
+
+	cgroup_path(ch->cg, buf, sizeof(buf));
+	fprintf(stdout, "------ churn\n");
+	fprintf(stdout, "spawners = %d, cgroup = %s\n", ch->n_spawners, buf);
+	fprintf(stdout, "tasks: spawned = %llu, exited = %llu, alive = %d, "
+		"max alive = %d, refused = %llu\n", ch->spawned, ch->exited,
+		ch->alive, ch->max_alive, ch->refused);
+	fprintf(stdout, "rate: %.1f spawns/s, %.1f exits/s\n",
+		secs > 0 ? ch->spawned / secs : 0,
+		secs > 0 ? ch->exited / secs : 0);
+	print_latencies("fork to first run", ch->first_run, ch->n_first_run);
+	fprintf(stdout, "first run: samecpu = %.1f%%, samellc = %.1f%%, "
+		"remote = %.1f%%\n", ch->first_run_same_cpu * w,
+		ch->first_run_same_llc * w, ch->first_run_remote * w);
+	print_latencies("fork to exit", ch->turnaround, ch->n_turnaround);
+}
+
+void linsched_destroy_churn(struct linsched_churn *ch)
+{
+	struct churn_child *c, *tmp;
+	int i;
+
+	if (!ch)
+		return;
+
+	for (i = 0; ch->spawners && i < ch->n_spawners; i++) {
+		struct thread_info *ti = task_thread_info(ch->spawners[i]);
+		struct churn_spawner *s = ti->td->data;
+
+		hrtimer_cancel(&s->sr_data.timer);
+		free(s);
+		free(ti->td);
+		ti->td = NULL;
+	}
+	/* children still alive are left without a task model */
+	list_for_each_entry_safe(c, tmp, &ch->children, list) {
+		hrtimer_cancel(&c->sr_data.timer);
+		task_thread_info(c->sr_data.p)->td = NULL;
+		free(c->td);
+		free(c);
+	}
+	if (ch->interval)
+		linsched_destroy_dist(ch->interval);
+	if (ch->cost)
+		linsched_destroy_dist(ch->cost);
+	if (ch->lifetime)
+		linsched_destroy_dist(ch->lifetime);
+	free(ch->first_run);
+	free(ch->turnaround);
+	free(ch->spawners);
+	free(ch);
+}
@@ -0,0 +1,46 @@
+/* Fork / exit churn for linsched
+ *
+ * Spawner tasks fork short lived children at random intervals, like a
+ * build or CI host does; each child runs for a random amount of cpu
+ * time and exits through linsched_exit_task(). This exercises
+ * sched_fork() and wake_up_new_task() placement and the exit path, and
+ * keeps reusing task ids and pids.
+ *
+ * The report gives the fork to first run latency of the children,
+ * where they first ran relative to the cpu that forked them, their
+ * fork to exit time, and the spawn and exit rates that were sustained.
+ */
+
+#ifndef __LINSCHED_CHURN_H
+#define __LINSCHED_CHURN_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+struct linsched_churn {
+	int n_spawners;
+	struct task_struct **spawners;
+	struct cgroup *cg;
+	const struct cpumask *cpus;
+	struct rand_dist *interval;	/* ns between forks of a spawner */
+	struct rand_dist *cost;		/* ns a spawner runs per fork */
+	struct rand_dist *lifetime;	/* ns a child runs */
+	struct list_head children;	/* alive */
+	u64 start;
+
+	u64 spawned, exited, refused;
+	int alive, max_alive;
+	u64 first_run_same_cpu, first_run_same_llc, first_run_remote;
+
+	/* of the children, ns */
+	u64 *first_run, n_first_run, max_first_run;
+	u64 *turnaround, n_turnaround, max_turnaround;
+};
+
+struct linsched_churn *linsched_load_churn(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state);
+void linsched_print_churn_report(struct linsched_churn *ch);
+void linsched_destroy_churn(struct linsched_churn *ch);
+
+#endif	/* __LINSCHED_CHURN_H */
@@ -0,0 +1,451 @@
+/* Block devices for linsched, see linsched_io.h */
+
+#include "linsched.h"
+#include "linsched_io.h"
+#include "linsched_sim.h"
+#include <linux/tick.h>
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+struct io_task {
+	struct sleep_run_data sr_data;
+	struct io_group *group;
+	struct linsched_io_req req;
+	u64 run;		/* ns of the current run */
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+u64 linsched_io_gen_service(struct linsched_io_dev *dev)
+{
+	BUG_ON(!dev->service);
+	return gen_ns(dev->service);
+}
+
+/* to be called before in_flight or queued change */
+static void io_account(struct linsched_io_dev *dev)
+{
+	u64 delta = current_time - dev->last_change;
+
+	if (dev->in_flight)
+		dev->busy_time += delta;
+	dev->depth_time += delta * (dev->in_flight + dev->queued);
+	dev->last_change = current_time;
+}
+
+/* the completion interrupt comes on the irq cpu, pinned there */
+static void io_start(struct linsched_io_dev *dev, struct linsched_io_req *req)
+{
+	int old_cpu = smp_processor_id();
+
+	dev->in_flight++;
+	dev->queue_wait += current_time - req->submitted;
+	linsched_change_cpu(dev->irq_cpu >= 0 ? dev->irq_cpu : req->cpu);
+	hrtimer_start(&req->timer, ns_to_ktime(max(req->service, 1ULL)),
+		      HRTIMER_MODE_REL_PINNED);
+	linsched_change_cpu(old_cpu);
+}
+
+static enum hrtimer_restart io_complete(struct hrtimer *timer)
+{
+	struct linsched_io_req *req =
+		container_of(timer, struct linsched_io_req, timer);
+	struct linsched_io_dev *dev = req->dev;
+	int this_cpu = smp_processor_id(), cpu;
+
+	io_account(dev);
+	dev->in_flight--;
+	dev->completed++;
+	dev->service_time += req->service;
+	if (dev->n_latencies == dev->max_latencies) {
+		dev->max_latencies = max(2 * dev->max_latencies, 1024ULL);
+		dev->latencies = realloc(dev->latencies, dev->max_latencies *
+					 sizeof(u64));
+		BUG_ON(!dev->latencies);
+	}
+	dev->latencies[dev->n_latencies++] = current_time - req->submitted;
+	req->completed = current_time;
+
+	/* where select_task_rq() put the task, seen from the irq */
+	wake_up_process(req->p);
+	cpu = task_cpu(req->p);
+	if (cpu == this_cpu)
+		dev->wake_irq_cpu++;
+	else if (cpumask_test_cpu(cpu, cpu_coregroup_mask(this_cpu)))
+		dev->wake_irq_llc++;
+	else
+		dev->wake_remote++;
+	if (cpu == req->cpu)
+		dev->wake_prev_cpu++;
+
+	if (!list_empty(&dev->queue)) {
+		struct linsched_io_req *next =
+			list_first_entry(&dev->queue, struct linsched_io_req,
+					 list);
+
+		list_del_init(&next->list);
+		dev->queued--;
+		io_start(dev, next);
+	}
+	return HRTIMER_NORESTART;
+}
+
+void linsched_io_init_req(struct linsched_io_req *req)
+{
+	memset(req, 0, sizeof(*req));
+	INIT_LIST_HEAD(&req->list);
+	hrtimer_init(&req->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	req->timer.function = io_complete;
+}
+
+/* Submits a request of service ns to dev and puts p, which must be
+ * current, to sleep until it completes, accounted as iowait like
+ * io_schedule() does. Once p runs again, its task model has to call
+ * linsched_io_done() before using req again. */
+void linsched_io_wait(struct linsched_io_dev *dev, struct linsched_io_req *req,
+		      struct task_struct *p, u64 service)
+{
+	BUG_ON(p != current || req->p);
+
+	req->dev = dev;
+	req->p = p;
+	req->cpu = task_cpu(p);
+	req->service = service;
+	req->submitted = current_time;
+	req->completed = 0;
+	dev->requests++;
+
+	io_account(dev);
+	if (dev->in_flight < dev->depth) {
+		io_start(dev, req);
+	} else {
+		list_add_tail(&req->list, &dev->queue);
+		dev->max_queued = max(dev->max_queued, ++dev->queued);
+	}
+
+	atomic_inc(&cpu_rq(req->cpu)->nr_iowait);
+	p->in_iowait = 1;
+	p->state = TASK_UNINTERRUPTIBLE;
+	schedule();
+}
+
+/* Returns true if the request of req, if any, is over, and then ends
+ * the iowait of its task; to be called by the task. */
+int linsched_io_done(struct linsched_io_req *req)
+{
+	struct task_struct *p = req->p;
+
+	if (!p)
+		return 1;
+	if (!req->completed)
+		return 0;
+
+	p->in_iowait = 0;
+	atomic_dec(&cpu_rq(req->cpu)->nr_iowait);
+	req->dev->wakeup_latency += current_time - req->completed;
+	req->p = NULL;
+	return 1;
+}
+
+static void io_task_start(struct task_struct *p, void *data)
+{
+	struct io_task *t = data;
+
+	sleep_run_start(p, &t->sr_data);
+}
+
+/* runs, then waits for one request, and so on */
+static void io_task_handle(struct task_struct *p, void *data)
+{
+	struct io_task *t = data;
+	struct linsched_io_dev *dev = t->group->dev;
+
+	if (!linsched_io_done(&t->req))
+		return;
+	if (!sleep_run_run_for(&t->sr_data, t->run))
+		return;
+
+	t->run = gen_ns(t->group->run);
+	hrtimer_try_to_cancel(&t->sr_data.timer);
+	linsched_io_wait(dev, &t->req, p, linsched_io_gen_service(dev));
+}
+
+static struct linsched_io_dev *find_dev(struct linsched_io *io,
+					const char *name)
+{
+	int i;
+
+	for (i = 0; i < io->n_devs; i++)
+		if (!strcmp(io->devs[i]->name, name))
+			return io->devs[i];
+	return NULL;
+}
+
+static int parse_io_line(struct linsched_io *io, char *line,
+			 unsigned int *rand_state)
+{
+	char name[32], arg[128];
+	struct linsched_io_dev *dev;
+	struct io_group *g;
+	int n, len;
+
+	if (sscanf(line, "DEVICE %31s %d %15s %n", name, &n, arg,
+		   &len) >= 3) {
+		if (io->n_devs == IO_MAX_DEVICES || find_dev(io, name) ||
+		    n <= 0)
+			return -1;
+		dev = calloc(1, sizeof(*dev));
+		BUG_ON(!dev);
+		strcpy(dev->name, name);
+		dev->depth = n;
+		INIT_LIST_HEAD(&dev->queue);
+		io->devs[io->n_devs++] = dev;
+
+		if (!strcmp(arg, "-")) {
+			dev->irq_cpu = -1;
+		} else if (sscanf(arg, "%d", &dev->irq_cpu) != 1 ||
+			   dev->irq_cpu < 0 || dev->irq_cpu >= nr_cpu_ids ||
+			   !cpu_online(dev->irq_cpu)) {
+			return -1;
+		}
+
+		line += len;
+		if (!*line)
+			return 0;
+		dev->service = linsched_parse_distribution(&line, rand_state);
+		return dev->service ? 0 : -1;
+	}
+
+	if (sscanf(line, "TASKS %d %31s %127s %n", &n, name, arg, &len) < 3)
+		return -1;
+	dev = find_dev(io, name);
+	if (n <= 0 || !dev || !dev->service || arg[0] != '/' ||
+	    io->n_groups == IO_MAX_GROUPS)
+		return -1;
+
+	line += len;
+	g = calloc(1, sizeof(*g));
+	BUG_ON(!g);
+	g->run = linsched_parse_distribution(&line, rand_state);
+	if (!g->run) {
+		free(g);
+		return -1;
+	}
+	g->dev = dev;
+	g->n_tasks = n;
+	g->cg = linsched_find_cgroup(arg, 1);
+	io->n_tasks += n;
+	io->groups[io->n_groups++] = g;
+	return 0;
+}
+
+/* Creates the devices, and tasks using them, described by a file of
+ * lines
+ *   DEVICE <name> <depth> <irq cpu or -> [<service dist>]
+ *   TASKS <n> <device> <cgroup> <run dist>
+ * where distributions are in ns, as in linsched_create_sim(). The
+ * completions of a device with irq cpu "-" come on the cpu that
+ * submitted the request. TASKS alternate between running for the run
+ * distribution and waiting for one request to their device, which
+ * needs a service distribution for them. Empty lines and lines
+ * starting with '#' are ignored. */
+struct linsched_io *linsched_load_io(char *filename,
+				     const struct cpumask *cpus,
+				     unsigned int *rand_state)
+{
+	struct linsched_io *io = calloc(1, sizeof(*io));
+	char line[256];
+	FILE *f;
+	int i, j, k = 0, lineno = 0, cpu;
+
+	BUG_ON(!io);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_io_line(io, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad io line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!io->n_devs) {
+		fprintf(stderr, "%s: no DEVICE\n", filename);
+		goto err;
+	}
+
+	io->start = current_time;
+	for (i = 0; i < io->n_devs; i++)
+		io->devs[i]->last_change = current_time;
+	for_each_online_cpu(cpu) {
+		io->idle_start[cpu] = get_cpu_idle_time_us(cpu, NULL);
+		io->iowait_start[cpu] = get_cpu_iowait_time_us(cpu, NULL);
+	}
+
+	io->tasks = calloc(io->n_tasks, sizeof(struct task_struct *));
+	BUG_ON(io->n_tasks && !io->tasks);
+	for (i = 0; i < io->n_groups; i++) {
+		struct io_group *g = io->groups[i];
+
+		for (j = 0; j < g->n_tasks; j++, k++) {
+			struct task_data *td = malloc(sizeof(struct task_data));
+			struct io_task *t = calloc(1, sizeof(*t));
+
+			BUG_ON(!td || !t);
+			t->group = g;
+			t->run = gen_ns(g->run);
+			linsched_io_init_req(&t->req);
+			sleep_run_init(&t->sr_data);
+			td->data = t;
+			td->init_task = io_task_start;
+			td->handle_task = io_task_handle;
+			io->tasks[k] = linsched_create_normal_task(td, 0);
+			set_cpus_allowed_ptr(io->tasks[k], cpus);
+			linsched_add_task_to_group(io->tasks[k], g->cg);
+		}
+	}
+	return io;
+
+err:
+	linsched_destroy_io(io);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(struct linsched_io_dev *dev, double pct)
+{
+	u64 n = dev->n_latencies;
+
+	if (!n)
+		return 0;
+	return dev->latencies[min((u64)(n * pct / 100), n - 1)] / 1000.0;
+}
+
+static double per_req_us(u64 ns, u64 n)
+{
+	return n ? ns / 1000.0 / n : 0;
+}
+
+void linsched_print_io_report(struct linsched_io *io)
+{
+	u64 elapsed = current_time - io->start;
+	int i, cpu;
+
+	fprintf(stdout, "------ io\n");
+	fprintf(stdout, "%-12s %5s %4s %9s %9s %6s %6s %6s %9s %9s\n",
+		"device", "depth", "irq", "requests", "iops", "util%", "avgq",
+		"maxq", "qwait_us", "svc_us");
+	for (i = 0; i < io->n_devs; i++) {
+		struct linsched_io_dev *dev = io->devs[i];
+		char irq[16] = "-";
+
+		io_account(dev);
+		if (dev->irq_cpu >= 0)
+			snprintf(irq, sizeof(irq), "%d", dev->irq_cpu);
+		fprintf(stdout, "%-12s %5d %4s %9llu %9.1f %6.1f %6.2f %6d "
+			"%9.1f %9.1f\n", dev->name, dev->depth, irq,
+			dev->requests,
+			elapsed ? dev->completed * (double)NSEC_PER_SEC /
+			elapsed : 0,
+			elapsed ? 100.0 * dev->busy_time / elapsed : 0,
+			elapsed ? (double)dev->depth_time / elapsed : 0,
+			dev->max_queued,
+			per_req_us(dev->queue_wait,
+				   dev->requests - dev->queued),
+			per_req_us(dev->service_time, dev->completed));
+	}
+
+	fprintf(stdout, "%-12s %9s %9s %9s %9s %11s %8s %8s %8s %9s\n",
+		"device", "lat_us", "lat_p50", "lat_p99", "lat_max",
+		"wakelat_us", "irqcpu%", "irqllc%", "remote%", "prevcpu%");
+	for (i = 0; i < io->n_devs; i++) {
+		struct linsched_io_dev *dev = io->devs[i];
+		double w = dev->completed ? 100.0 / dev->completed : 0;
+		u64 sum = 0, j;
+
+		qsort(dev->latencies, dev->n_latencies, sizeof(u64),
+		      u64_compare);
+		for (j = 0; j < dev->n_latencies; j++)
+			sum += dev->latencies[j];
+		fprintf(stdout, "%-12s %9.1f %9.1f %9.1f %9.1f %11.1f %8.1f "
+			"%8.1f %8.1f %9.1f\n", dev->name,
+			per_req_us(sum, dev->n_latencies),
+			percentile_us(dev, 50), percentile_us(dev, 99),
+			percentile_us(dev, 100),
+			per_req_us(dev->wakeup_latency, dev->completed),
+			dev->wake_irq_cpu * w, dev->wake_irq_llc * w,
+			dev->wake_remote * w, dev->wake_prev_cpu * w);
+	}
+
+	/* idle time with tasks of the cpu waiting for IO, as tick-sched
+	 * accounts it for cpufreq governors and /proc/stat */
+	fprintf(stdout, "%4s %10s %10s\n", "cpu", "idle_ms", "iowait_ms");
+	for_each_online_cpu(cpu) {
+		u64 idle = get_cpu_idle_time_us(cpu, NULL);
+		u64 iowait = get_cpu_iowait_time_us(cpu, NULL);
+
+		if (idle == -1ULL || iowait == -1ULL)
+			break;
+		fprintf(stdout, "%4d %10.1f %10.1f\n", cpu,
+			(idle - io->idle_start[cpu]) / 1000.0,
+			(iowait - io->iowait_start[cpu]) / 1000.0);
+	}
+}
+
+void linsched_destroy_io(struct linsched_io *io)
+{
+	int i;
+
+	if (!io)
+		return;
+
+	for (i = 0; io->tasks && i < io->n_tasks; i++) {
+		struct thread_info *ti = task_thread_info(io->tasks[i]);
+		struct io_task *t = ti->td->data;
+
+		hrtimer_cancel(&t->req.timer);
+		hrtimer_cancel(&t->sr_data.timer);
+		free(t);
+		free(ti->td);
+		ti->td = NULL;
+	}
+	for (i = 0; i < io->n_groups; i++) {
+		linsched_destroy_dist(io->groups[i]->run);
+		free(io->groups[i]);
+	}
+	for (i = 0; i < io->n_devs; i++) {
+		if (io->devs[i]->service)
+			linsched_destroy_dist(io->devs[i]->service);
+		free(io->devs[i]->latencies);
+		free(io->devs[i]);
+	}
+	free(io->tasks);
+	free(io);
+}
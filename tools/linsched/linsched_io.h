@@ -0,0 +1,83 @@
+/* Block devices for linsched
+ *
+ * A device serves up to depth requests at once, for service times
+ * given by the submitter or drawn from a distribution; further
+ * requests queue. A task waits for its request in TASK_UNINTERRUPTIBLE
+ * and is counted in rq->nr_iowait of the cpu it slept on, as with
+ * io_schedule(), and the completion interrupt wakes it from the
+ * device's irq cpu (or from the cpu that submitted the request), so
+ * select_task_rq() sees the wakeup where the kernel would. IO wait
+ * therefore grows with the load on the device instead of being a
+ * fixed sleep.
+ *
+ * Task models use linsched_io_wait() and linsched_io_done(); perf
+ * replay tasks send their IOWAIT events to a device when one is given
+ * (see linsched_create_perf_tasks()), and the TASKS of an io file
+ * alternate between running and one synchronous request.
+ */
+
+#ifndef __LINSCHED_IO_DEV_H
+#define __LINSCHED_IO_DEV_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define IO_MAX_DEVICES 16
+#define IO_MAX_GROUPS 32
+
+struct linsched_io_dev {
+	char name[32];
+	int depth;
+	int irq_cpu;			/* -1 for the submitting cpu */
+	struct rand_dist *service;	/* ns, may be NULL */
+
+	struct list_head queue;		/* waiting for a slot */
+	int queued, max_queued, in_flight;
+	u64 last_change, busy_time, depth_time;
+
+	/* stats */
+	u64 requests, completed, service_time, queue_wait;
+	u64 *latencies, n_latencies, max_latencies;	/* ns */
+	u64 wakeup_latency;
+	u64 wake_irq_cpu, wake_irq_llc, wake_remote, wake_prev_cpu;
+};
+
+struct linsched_io_req {
+	struct list_head list;
+	struct linsched_io_dev *dev;
+	struct task_struct *p;		/* NULL when idle */
+	int cpu;			/* slept on */
+	u64 service, submitted, completed;
+	struct hrtimer timer;
+};
+
+/* tasks that run and then do IO to the same device */
+struct io_group {
+	struct linsched_io_dev *dev;
+	struct cgroup *cg;
+	int n_tasks;
+	struct rand_dist *run;		/* ns of cpu time between requests */
+};
+
+struct linsched_io {
+	int n_devs, n_groups, n_tasks;
+	struct linsched_io_dev *devs[IO_MAX_DEVICES];
+	struct io_group *groups[IO_MAX_GROUPS];
+	struct task_struct **tasks;
+	u64 start;
+	u64 idle_start[NR_CPUS], iowait_start[NR_CPUS];	/* us */
+};
+
+void linsched_io_init_req(struct linsched_io_req *req);
+void linsched_io_wait(struct linsched_io_dev *dev, struct linsched_io_req *req,
+		      struct task_struct *p, u64 service);
+int linsched_io_done(struct linsched_io_req *req);
+u64 linsched_io_gen_service(struct linsched_io_dev *dev);
+
+struct linsched_io *linsched_load_io(char *filename,
+				     const struct cpumask *cpus,
+				     unsigned int *rand_state);
+void linsched_print_io_report(struct linsched_io *io);
+void linsched_destroy_io(struct linsched_io *io);
+
+#endif	/* __LINSCHED_IO_DEV_H */
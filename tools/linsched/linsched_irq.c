@@ -0,0 +1,244 @@
+/* Device interrupt load for linsched, see linsched_irq.h */
+
+#include "linsched.h"
+#include "linsched_irq.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+/* the interrupt comes on src->cpu, pinned there */
+static void irq_arm(struct irq_source *src)
+{
+	int old_cpu = smp_processor_id();
+
+	linsched_change_cpu(src->cpu);
+	hrtimer_start(&src->timer,
+		      ns_to_ktime(max(gen_ns(src->s->interval), 1ULL)),
+		      HRTIMER_MODE_REL_PINNED);
+	linsched_change_cpu(old_cpu);
+}
+
+static enum hrtimer_restart irq_fire(struct hrtimer *timer)
+{
+	struct irq_source *src = container_of(timer, struct irq_source, timer);
+	struct irq_stream *s = src->s;
+	struct linsched_irq *irq = s->irq;
+	int cpu = smp_processor_id(), next;
+	u64 hard = gen_ns(s->hardirq);
+	u64 soft = s->softirq ? gen_ns(s->softirq) : 0;
+	unsigned long power = cpu_rq(cpu)->cpu_power;
+
+	linsched_account_irq_time(cpu, hard, soft);
+	s->count++;
+	s->hardirq_time += hard;
+	s->softirq_time += soft;
+	irq->count[cpu]++;
+	irq->hardirq_time[cpu] += hard;
+	irq->softirq_time[cpu] += soft;
+	irq->power_sum[cpu] += power;
+	if (!irq->power_min[cpu] || power < irq->power_min[cpu])
+		irq->power_min[cpu] = power;
+
+	next = cpu;
+	if (s->steered) {
+		next = cpumask_next(cpu, &s->cpus);
+		if (next >= nr_cpu_ids)
+			next = cpumask_first(&s->cpus);
+	}
+	if (next != cpu) {
+		irq_arm(&s->src[next]);
+		return HRTIMER_NORESTART;
+	}
+	hrtimer_forward_now(timer,
+			    ns_to_ktime(max(gen_ns(s->interval), 1ULL)));
+	return HRTIMER_RESTART;
+}
+
+static void destroy_stream(struct irq_stream *s)
+{
+	int cpu;
+
+	for_each_cpu(cpu, &s->cpus)
+		hrtimer_cancel(&s->src[cpu].timer);
+	if (s->interval)
+		linsched_destroy_dist(s->interval);
+	if (s->hardirq)
+		linsched_destroy_dist(s->hardirq);
+	if (s->softirq)
+		linsched_destroy_dist(s->softirq);
+	free(s);
+}
+
+static int parse_irq_line(struct linsched_irq *irq, char *line,
+			  unsigned int *rand_state)
+{
+	char name[32], steer[16], cpus[64];
+	struct irq_stream *s;
+	int i, len;
+
+	if (sscanf(line, "IRQ %31s %15s %63s %n", name, steer, cpus,
+		   &len) < 3 || irq->n_streams == IRQ_MAX_STREAMS)
+		return -1;
+	for (i = 0; i < irq->n_streams; i++)
+		if (!strcmp(irq->streams[i]->name, name))
+			return -1;
+
+	s = calloc(1, sizeof(*s));
+	BUG_ON(!s);
+	strcpy(s->name, name);
+	s->irq = irq;
+	for (i = 0; i < NR_CPUS; i++) {
+		s->src[i].s = s;
+		s->src[i].cpu = i;
+		hrtimer_init(&s->src[i].timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		s->src[i].timer.function = irq_fire;
+	}
+	if (!strcmp(steer, "STEERED"))
+		s->steered = 1;
+	else if (strcmp(steer, "PERCPU"))
+		goto err;
+	if (!strcmp(cpus, "all"))
+		cpumask_copy(&s->cpus, cpu_online_mask);
+	else if (cpulist_parse(cpus, &s->cpus))
+		goto err;
+	cpumask_and(&s->cpus, &s->cpus, cpu_online_mask);
+	if (cpumask_empty(&s->cpus))
+		goto err;
+
+	line += len;
+	s->interval = linsched_parse_distribution(&line, rand_state);
+	if (s->interval)
+		s->hardirq = linsched_parse_distribution(&line, rand_state);
+	while (s->hardirq && isspace(*line))
+		line++;
+	if (s->hardirq && *line)
+		s->softirq = linsched_parse_distribution(&line, rand_state);
+	if (!s->hardirq || (*line && !s->softirq))
+		goto err;
+
+	irq->streams[irq->n_streams++] = s;
+	return 0;
+
+err:
+	destroy_stream(s);
+	return -1;
+}
+
+/* Starts the interrupt streams described by a file of lines
+ *   IRQ <name> PERCPU|STEERED <cpu list|all> <interval dist>
+ *       <hardirq dist> [<softirq dist>]
+ * (on one line) where the distributions are in ns, as in
+ * linsched_create_sim(), and cpus that are not online are left out.
+ * Empty lines and lines starting with '#' are ignored. */
+struct linsched_irq *linsched_load_irq(char *filename,
+				       unsigned int *rand_state)
+{
+	struct linsched_irq *irq = calloc(1, sizeof(*irq));
+	char line[256];
+	FILE *f;
+	int i, cpu, lineno = 0;
+
+	BUG_ON(!irq);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_irq_line(irq, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad irq line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!irq->n_streams) {
+		fprintf(stderr, "%s: no IRQ lines\n", filename);
+		goto err;
+	}
+
+	enable_sched_clock_irqtime();
+	for (i = 0; i < irq->n_streams; i++) {
+		struct irq_stream *s = irq->streams[i];
+
+		if (s->steered) {
+			irq_arm(&s->src[cpumask_first(&s->cpus)]);
+			continue;
+		}
+		for_each_cpu(cpu, &s->cpus)
+			irq_arm(&s->src[cpu]);
+	}
+	irq->start = current_time;
+	return irq;
+
+err:
+	linsched_destroy_irq(irq);
+	return NULL;
+}
+
+void linsched_print_irq_report(struct linsched_irq *irq)
+{
+	u64 elapsed = current_time - irq->start;
+	double secs = elapsed / (double)NSEC_PER_SEC;
+	char buf[64];
+	int i, cpu;
+
+	fprintf(stdout, "------ irq\n");
+	fprintf(stdout, "%-12s %-8s %-10s %10s %9s %9s %9s\n", "stream",
+		"steer", "cpus", "count", "rate/s", "hard_us", "soft_us");
+	for (i = 0; i < irq->n_streams; i++) {
+		struct irq_stream *s = irq->streams[i];
+
+		cpulist_scnprintf(buf, sizeof(buf), &s->cpus);
+		fprintf(stdout, "%-12s %-8s %-10s %10llu %9.1f %9.2f %9.2f\n",
+			s->name, s->steered ? "STEERED" : "PERCPU", buf,
+			s->count, secs > 0 ? s->count / secs : 0,
+			s->count ? s->hardirq_time / 1000.0 / s->count : 0,
+			s->count ? s->softirq_time / 1000.0 / s->count : 0);
+	}
+
+	fprintf(stdout, "%4s %10s %11s %11s %6s %9s %9s %9s\n", "cpu",
+		"irqs", "hardirq_ms", "softirq_ms", "irq%", "power",
+		"power_avg", "power_min");
+	for_each_online_cpu(cpu) {
+		u64 t = irq->hardirq_time[cpu] + irq->softirq_time[cpu];
+		u64 n = irq->count[cpu];
+
+		fprintf(stdout, "%4d %10llu %11.1f %11.1f %6.1f %9lu %9.0f "
+			"%9lu\n", cpu, n, irq->hardirq_time[cpu] / 1e6,
+			irq->softirq_time[cpu] / 1e6,
+			elapsed ? 100.0 * t / elapsed : 0,
+			cpu_rq(cpu)->cpu_power,
+			n ? (double)irq->power_sum[cpu] / n : 0,
+			irq->power_min[cpu]);
+	}
+}
+
+void linsched_destroy_irq(struct linsched_irq *irq)
+{
+	int i;
+
+	if (!irq)
+		return;
+
+	for (i = 0; i < irq->n_streams; i++)
+		destroy_stream(irq->streams[i]);
+	free(irq);
+}
@@ -0,0 +1,67 @@
+/* Device interrupt load for linsched
+ *
+ * The tick, IPIs and the other interrupts of linsched take no simulated
+ * time. An irq model adds streams of device interrupts whose handlers
+ * do: every interrupt charges a hardirq time, and optionally a softirq
+ * time, to the cpu it lands on through the CONFIG_IRQ_TIME_ACCOUNTING
+ * counters. update_rq_clock() then holds rq->clock_task back by that
+ * much, so the task running there gets less cpu time, and adds it to
+ * rq->rt_avg, so scale_rt_power() lowers the cpu_power that the load
+ * balancer sees.
+ *
+ * A PERCPU stream interrupts each of its cpus independently at its
+ * rate, like a multiqueue NIC with a queue per cpu. A STEERED stream
+ * is a single stream at its rate whose interrupts go round robin over
+ * its cpus, as irqbalance or RSS spreading would do. Softirq work is
+ * always charged on irq exit of the same cpu; there is no ksoftirqd.
+ */
+
+#ifndef __LINSCHED_IRQ_H
+#define __LINSCHED_IRQ_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define IRQ_MAX_STREAMS 16
+
+struct linsched_irq;
+struct irq_stream;
+
+/* a stream's interrupts on one cpu */
+struct irq_source {
+	struct irq_stream *s;
+	int cpu;
+	struct hrtimer timer;
+};
+
+struct irq_stream {
+	char name[32];
+	struct linsched_irq *irq;
+	int steered;
+	cpumask_t cpus;
+	struct rand_dist *interval;	/* ns between interrupts */
+	struct rand_dist *hardirq;	/* ns in the handler */
+	struct rand_dist *softirq;	/* ns of softirq work, or NULL */
+	struct irq_source src[NR_CPUS];
+
+	/* stats */
+	u64 count, hardirq_time, softirq_time;
+};
+
+struct linsched_irq {
+	int n_streams;
+	struct irq_stream *streams[IRQ_MAX_STREAMS];
+	u64 start;
+
+	/* per cpu stats */
+	u64 count[NR_CPUS], hardirq_time[NR_CPUS], softirq_time[NR_CPUS];
+	u64 power_sum[NR_CPUS];		/* cpu_power seen by the interrupts */
+	unsigned long power_min[NR_CPUS];
+};
+
+struct linsched_irq *linsched_load_irq(char *filename,
+				       unsigned int *rand_state);
+void linsched_print_irq_report(struct linsched_irq *irq);
+void linsched_destroy_irq(struct linsched_irq *irq);
+
+#endif	/* __LINSCHED_IRQ_H */
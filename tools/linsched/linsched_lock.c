@@ -0,0 +1,507 @@
+/* Contended locks for linsched, see linsched_lock.h */
+
+#include "linsched.h"
+#include "linsched_lock.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+enum lock_state {
+	LOCK_OUTSIDE,		/* running without the lock */
+	LOCK_SPIN,		/* spinning for it */
+	LOCK_BLOCKED,		/* waiting for it, or woken to try again */
+	LOCK_HOLD,		/* running with the lock held */
+};
+
+struct lock_task {
+	struct sleep_run_data sr_data;
+	struct lock_group *group;
+	enum lock_state state;
+	u64 burst;		/* ns of the current run */
+	u64 want;		/* when the lock was asked for */
+	u64 spin_start;
+	unsigned long nivcsw;	/* at acquisition */
+	struct list_head spin_list;
+	wait_queue_t wait;
+	int waiting;
+	u64 woken;
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+static void add_sample(u64 **samples, u64 *n, u64 *max, u64 v)
+{
+	if (*n == *max) {
+		*max = max(2 * *max, 1024ULL);
+		*samples = realloc(*samples, *max * sizeof(u64));
+		BUG_ON(!*samples);
+	}
+	(*samples)[(*n)++] = v;
+}
+
+static struct task_struct *lock_task_p(struct lock_task *t)
+{
+	return t->sr_data.p;
+}
+
+/* t gets the lock, either itself or handed over by the releaser */
+static void sim_lock_take(struct sim_lock *lk, struct lock_task *t)
+{
+	if (!list_empty(&t->spin_list)) {
+		list_del_init(&t->spin_list);
+		lk->spin_time += current_time - t->spin_start;
+	}
+	lk->owner = t;
+	lk->acquired = current_time;
+	lk->acquisitions++;
+	add_sample(&lk->waits, &lk->n_waits, &lk->max_waits,
+		   current_time - t->want);
+
+	t->nivcsw = lock_task_p(t)->nivcsw;
+	t->state = LOCK_HOLD;
+	t->burst = gen_ns(t->group->inside);
+	/* whatever t was running for is over */
+	t->sr_data.last_start = 0;
+}
+
+/* makes the handler of a spinner that was handed the lock run, on its
+ * cpu, as soon as possible */
+static void sim_lock_kick(struct lock_task *t)
+{
+	int old_cpu = smp_processor_id();
+
+	linsched_change_cpu(task_cpu(lock_task_p(t)));
+	hrtimer_start(&t->sr_data.timer, ns_to_ktime(1), HRTIMER_MODE_REL);
+	linsched_change_cpu(old_cpu);
+}
+
+static void sim_lock_end_convoy(struct sim_lock *lk)
+{
+	if (lk->convoy_len >= LOCK_CONVOY_MIN) {
+		lk->convoys++;
+		lk->longest_convoy = max(lk->longest_convoy, lk->convoy_len);
+		lk->convoy_time += current_time - lk->convoy_start;
+	}
+	lk->convoy_len = 0;
+}
+
+static void sim_lock_release(struct sim_lock *lk, struct lock_task *t)
+{
+	u64 held = current_time - lk->acquired;
+	struct lock_task *s;
+
+	add_sample(&lk->holds, &lk->n_holds, &lk->max_holds, held);
+	lk->held_time += held;
+	if (lock_task_p(t)->nivcsw != t->nivcsw)
+		lk->holder_preempted++;
+
+	/* a convoy goes on while every release finds tasks waiting */
+	if (!list_empty(&lk->spinners) || waitqueue_active(&lk->wq)) {
+		if (!lk->convoy_len++)
+			lk->convoy_start = lk->acquired;
+	} else {
+		sim_lock_end_convoy(lk);
+	}
+	lk->owner = NULL;
+
+	/* a spinner on a cpu sees the release first */
+	list_for_each_entry(s, &lk->spinners, spin_list) {
+		if (task_curr(lock_task_p(s))) {
+			sim_lock_take(lk, s);
+			sim_lock_kick(s);
+			break;
+		}
+	}
+	/* like mutex_unlock(), wake a waiter even if a spinner got it */
+	if (waitqueue_active(&lk->wq))
+		wake_up_interruptible(&lk->wq);
+}
+
+static void sim_lock_block(struct sim_lock *lk, struct lock_task *t)
+{
+	if (t->state == LOCK_BLOCKED)
+		lk->retries++;
+	else
+		lk->blocked++;
+	if (!list_empty(&t->spin_list)) {
+		list_del_init(&t->spin_list);
+		lk->spin_time += current_time - t->spin_start;
+		t->sr_data.last_start = 0;
+	}
+	t->state = LOCK_BLOCKED;
+
+	hrtimer_try_to_cancel(&t->sr_data.timer);
+	prepare_to_wait_exclusive(&lk->wq, &t->wait, TASK_INTERRUPTIBLE);
+	t->waiting = 1;
+	schedule();
+}
+
+/* called by __wake_up() for a waiting task, with the releaser current */
+static int lock_wake_function(wait_queue_t *wait, unsigned mode, int sync,
+			      void *key)
+{
+	struct lock_task *t = container_of(wait, struct lock_task, wait);
+	struct sim_lock *lk = t->group->lock;
+	int this_cpu = smp_processor_id(), cpu;
+
+	if (!autoremove_wake_function(wait, mode, sync, key))
+		return 0;
+
+	cpu = task_cpu(lock_task_p(t));
+	lk->wakeups++;
+	if (cpu == this_cpu)
+		lk->wake_same_cpu++;
+	else if (cpumask_test_cpu(cpu, cpu_coregroup_mask(this_cpu)))
+		lk->wake_same_llc++;
+	else
+		lk->wake_remote++;
+	t->woken = current_time;
+	return 1;
+}
+
+static void lock_task_start(struct task_struct *p, void *data)
+{
+	struct lock_task *t = data;
+
+	sleep_run_start(p, &t->sr_data);
+	init_wait(&t->wait);
+	t->wait.private = p;
+	t->wait.func = lock_wake_function;
+}
+
+static void lock_task_handle(struct task_struct *p, void *data)
+{
+	struct lock_task *t = data;
+	struct sim_lock *lk = t->group->lock;
+
+	if (t->waiting) {
+		finish_wait(&lk->wq, &t->wait);
+		t->waiting = 0;
+		if (t->woken)
+			lk->wakeup_latency += current_time - t->woken;
+		t->woken = 0;
+	}
+
+	while (1) {
+		switch (t->state) {
+		case LOCK_OUTSIDE:
+			if (!sleep_run_run_for(&t->sr_data, t->burst))
+				return;
+			t->want = current_time;
+			if (!lk->owner) {
+				sim_lock_take(lk, t);
+				break;
+			}
+			lk->contended++;
+			if (!lk->max_spin ||
+			    !task_curr(lock_task_p(lk->owner))) {
+				sim_lock_block(lk, t);
+				return;
+			}
+			lk->spun++;
+			t->spin_start = current_time;
+			list_add_tail(&t->spin_list, &lk->spinners);
+			t->state = LOCK_SPIN;
+			break;
+
+		case LOCK_SPIN:
+			if (!lk->owner) {
+				sim_lock_take(lk, t);
+				break;
+			}
+			/* spin on while the owner runs, which is only
+			 * checked whenever this handler runs anyway */
+			if (task_curr(lock_task_p(lk->owner)) &&
+			    !sleep_run_run_for(&t->sr_data, lk->max_spin))
+				return;
+			sim_lock_block(lk, t);
+			return;
+
+		case LOCK_BLOCKED:
+			/* woken, try again */
+			if (!lk->owner) {
+				sim_lock_take(lk, t);
+				break;
+			}
+			sim_lock_block(lk, t);
+			return;
+
+		case LOCK_HOLD:
+			if (!sleep_run_run_for(&t->sr_data, t->burst))
+				return;
+			sim_lock_release(lk, t);
+			t->state = LOCK_OUTSIDE;
+			t->burst = gen_ns(t->group->outside);
+			if (!t->group->sleep)
+				break;
+			sleep_run_sleep_for(&t->sr_data, TASK_INTERRUPTIBLE,
+					    max(gen_ns(t->group->sleep), 1ULL));
+			return;
+		}
+	}
+}
+
+static struct sim_lock *find_lock(struct linsched_locks *ls, const char *name)
+{
+	int i;
+
+	for (i = 0; i < ls->n_locks; i++)
+		if (!strcmp(ls->locks[i]->name, name))
+			return ls->locks[i];
+	return NULL;
+}
+
+static int parse_lock_line(struct linsched_locks *ls, char *line,
+			   unsigned int *rand_state)
+{
+	char name[32], path[128];
+	struct lock_group *g;
+	struct sim_lock *lk;
+	int n, len, spin = 0;
+
+	if (sscanf(line, "LOCK %31s %d", name, &spin) >= 1) {
+		if (ls->n_locks == LOCK_MAX_LOCKS || find_lock(ls, name) ||
+		    spin < 0)
+			return -1;
+		lk = calloc(1, sizeof(*lk));
+		BUG_ON(!lk);
+		strcpy(lk->name, name);
+		lk->max_spin = (u64)spin * NSEC_PER_USEC;
+		INIT_LIST_HEAD(&lk->spinners);
+		init_waitqueue_head(&lk->wq);
+		ls->locks[ls->n_locks++] = lk;
+		return 0;
+	}
+
+	if (sscanf(line, "TASKS %d %31s %127s %n", &n, name, path,
+		   &len) < 3)
+		return -1;
+	lk = find_lock(ls, name);
+	if (n <= 0 || !lk || path[0] != '/' ||
+	    ls->n_groups == LOCK_MAX_GROUPS)
+		return -1;
+
+	line += len;
+	g = calloc(1, sizeof(*g));
+	BUG_ON(!g);
+	g->lock = lk;
+	g->n_tasks = n;
+	g->outside = linsched_parse_distribution(&line, rand_state);
+	if (g->outside)
+		g->inside = linsched_parse_distribution(&line, rand_state);
+	while (g->inside && isspace(*line))
+		line++;
+	if (g->inside && *line)
+		g->sleep = linsched_parse_distribution(&line, rand_state);
+	if (!g->inside || (*line && !g->sleep)) {
+		if (g->outside)
+			linsched_destroy_dist(g->outside);
+		if (g->inside)
+			linsched_destroy_dist(g->inside);
+		free(g);
+		return -1;
+	}
+	g->cg = linsched_find_cgroup(path, 1);
+	lk->n_tasks += n;
+	ls->n_tasks += n;
+	ls->groups[ls->n_groups++] = g;
+	return 0;
+}
+
+/* Creates the tasks of a lock workload described by a file of lines
+ *   LOCK <name> [<max spin us>]
+ *   TASKS <n> <lock> <cgroup> <outside dist> <inside dist> [<sleep dist>]
+ * where the distributions are of the cpu time a task runs without and
+ * with the lock held and, if given, of the time it sleeps after each
+ * release, in ns as in linsched_create_sim(). A lock without a spin
+ * limit is never spun on. Empty lines and lines starting with
+ * '#' are ignored. */
+struct linsched_locks *linsched_load_locks(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state)
+{
+	struct linsched_locks *ls = calloc(1, sizeof(*ls));
+	char line[256];
+	FILE *f;
+	int i, j, k = 0, lineno = 0;
+
+	BUG_ON(!ls);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_lock_line(ls, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad lock line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!ls->n_tasks) {
+		fprintf(stderr, "%s: no TASKS use a LOCK\n", filename);
+		goto err;
+	}
+
+	ls->tasks = calloc(ls->n_tasks, sizeof(struct task_struct *));
+	BUG_ON(!ls->tasks);
+	for (i = 0; i < ls->n_groups; i++) {
+		struct lock_group *g = ls->groups[i];
+
+		for (j = 0; j < g->n_tasks; j++, k++) {
+			struct task_data *td = malloc(sizeof(struct task_data));
+			struct lock_task *t = calloc(1, sizeof(*t));
+
+			BUG_ON(!td || !t);
+			t->group = g;
+			t->state = LOCK_OUTSIDE;
+			t->burst = gen_ns(g->outside);
+			INIT_LIST_HEAD(&t->spin_list);
+			sleep_run_init(&t->sr_data);
+			td->data = t;
+			td->init_task = lock_task_start;
+			td->handle_task = lock_task_handle;
+			ls->tasks[k] = linsched_create_normal_task(td, 0);
+			set_cpus_allowed_ptr(ls->tasks[k], cpus);
+			linsched_add_task_to_group(ls->tasks[k], g->cg);
+		}
+	}
+	ls->start = current_time;
+	return ls;
+
+err:
+	linsched_destroy_locks(ls);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(u64 *samples, u64 n, double pct)
+{
+	if (!n)
+		return 0;
+	return samples[min((u64)(n * pct / 100), n - 1)] / 1000.0;
+}
+
+static double mean_us(u64 *samples, u64 n)
+{
+	u64 sum = 0, i;
+
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+	return n ? sum / 1000.0 / n : 0;
+}
+
+void linsched_print_lock_report(struct linsched_locks *ls)
+{
+	u64 elapsed = current_time - ls->start;
+	int i;
+
+	fprintf(stdout, "------ locks\n");
+	fprintf(stdout, "%-12s %5s %9s %6s %6s %6s %8s %6s %8s %9s %9s "
+		"%9s %9s %9s\n", "lock", "tasks", "acquires", "cont%",
+		"spin%", "block%", "retries", "util%", "preempt%", "hold_us",
+		"hold_p99", "wait_us", "wait_p99", "wait_max");
+	for (i = 0; i < ls->n_locks; i++) {
+		struct sim_lock *lk = ls->locks[i];
+		double a = lk->acquisitions ? 100.0 / lk->acquisitions : 0;
+		double h = lk->n_holds ? 100.0 / lk->n_holds : 0;
+
+		qsort(lk->holds, lk->n_holds, sizeof(u64), u64_compare);
+		qsort(lk->waits, lk->n_waits, sizeof(u64), u64_compare);
+		fprintf(stdout, "%-12s %5d %9llu %6.1f %6.1f %6.1f %8llu "
+			"%6.1f %8.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+			lk->name, lk->n_tasks, lk->acquisitions,
+			lk->contended * a, lk->spun * a, lk->blocked * a,
+			lk->retries,
+			elapsed ? 100.0 * lk->held_time / elapsed : 0,
+			lk->holder_preempted * h,
+			mean_us(lk->holds, lk->n_holds),
+			percentile_us(lk->holds, lk->n_holds, 99),
+			mean_us(lk->waits, lk->n_waits),
+			percentile_us(lk->waits, lk->n_waits, 99),
+			percentile_us(lk->waits, lk->n_waits, 100));
+	}
+
+	fprintf(stdout, "%-12s %8s %8s %8s %9s %9s %11s %8s %8s %8s\n",
+		"lock", "convoys", "longest", "convoy%", "spin_us", "wakeups",
+		"wakelat_us", "samecpu%", "samellc%", "remote%");
+	for (i = 0; i < ls->n_locks; i++) {
+		struct sim_lock *lk = ls->locks[i];
+		double w = lk->wakeups ? 100.0 / lk->wakeups : 0;
+		u64 convoys = lk->convoys, longest = lk->longest_convoy;
+		u64 convoy_time = lk->convoy_time;
+
+		/* a convoy still going on at the end */
+		if (lk->convoy_len >= LOCK_CONVOY_MIN) {
+			convoys++;
+			longest = max(longest, lk->convoy_len);
+			convoy_time += current_time - lk->convoy_start;
+		}
+		fprintf(stdout, "%-12s %8llu %8llu %8.1f %9.1f %9llu %11.1f "
+			"%8.1f %8.1f %8.1f\n", lk->name, convoys, longest,
+			elapsed ? 100.0 * convoy_time / elapsed : 0,
+			lk->spun ? lk->spin_time / 1000.0 / lk->spun : 0,
+			lk->wakeups,
+			lk->wakeups ? lk->wakeup_latency / 1000.0 /
+			lk->wakeups : 0,
+			lk->wake_same_cpu * w, lk->wake_same_llc * w,
+			lk->wake_remote * w);
+	}
+}
+
+void linsched_destroy_locks(struct linsched_locks *ls)
+{
+	int i;
+
+	if (!ls)
+		return;
+
+	for (i = 0; ls->tasks && i < ls->n_tasks; i++) {
+		struct thread_info *ti = task_thread_info(ls->tasks[i]);
+		struct lock_task *t = ti->td->data;
+
+		hrtimer_cancel(&t->sr_data.timer);
+		free(t);
+		free(ti->td);
+		ti->td = NULL;
+	}
+	for (i = 0; i < ls->n_groups; i++) {
+		linsched_destroy_dist(ls->groups[i]->outside);
+		linsched_destroy_dist(ls->groups[i]->inside);
+		if (ls->groups[i]->sleep)
+			linsched_destroy_dist(ls->groups[i]->sleep);
+		free(ls->groups[i]);
+	}
+	for (i = 0; i < ls->n_locks; i++) {
+		free(ls->locks[i]->holds);
+		free(ls->locks[i]->waits);
+		free(ls->locks[i]);
+	}
+	free(ls->tasks);
+	free(ls);
+}
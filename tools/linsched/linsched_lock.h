@@ -0,0 +1,75 @@
+/* Contended locks for linsched
+ *
+ * Models user space locks like those of a JVM: tasks alternate between
+ * running outside a lock and running with it held, for amounts of cpu
+ * time drawn from distributions. A task that finds the lock held
+ * spins for it while the owner is running on a cpu, up to a limit,
+ * like the OWNER_SPIN of kernel mutexes and adaptive futex locks do;
+ * otherwise, or once it gives up, it blocks on the wait queue of the
+ * lock, as in futex_wait(). Releasing the lock hands it to a spinner
+ * that is running, if there is one, and wakes one waiter, which has to
+ * try again and may find the lock taken.
+ *
+ * The report gives the hold and wait times per lock, how often the
+ * holder was preempted with the lock held, where woken waiters were
+ * placed, and lock convoys: runs of at least LOCK_CONVOY_MIN releases
+ * in a row with tasks waiting for the lock.
+ */
+
+#ifndef __LINSCHED_LOCK_H
+#define __LINSCHED_LOCK_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define LOCK_MAX_LOCKS 16
+#define LOCK_MAX_GROUPS 32
+#define LOCK_CONVOY_MIN 8
+
+struct lock_task;
+
+struct sim_lock {
+	char name[32];
+	u64 max_spin;			/* ns, 0 to never spin */
+	int n_tasks;
+
+	struct lock_task *owner;
+	u64 acquired;
+	struct list_head spinners;
+	wait_queue_head_t wq;
+
+	/* stats */
+	u64 acquisitions, contended, spun, blocked, retries;
+	u64 spin_time, held_time, holder_preempted;
+	u64 wakeups, wakeup_latency;
+	u64 wake_same_cpu, wake_same_llc, wake_remote;
+	u64 *holds, n_holds, max_holds;		/* ns, wall clock */
+	u64 *waits, n_waits, max_waits;		/* ns */
+	u64 convoy_len, convoy_start;		/* the current run */
+	u64 convoys, longest_convoy, convoy_time;
+};
+
+/* tasks that use the same lock the same way */
+struct lock_group {
+	struct sim_lock *lock;
+	struct cgroup *cg;
+	int n_tasks;
+	struct rand_dist *outside, *inside;	/* ns of cpu time */
+	struct rand_dist *sleep;		/* ns after a release, or NULL */
+};
+
+struct linsched_locks {
+	int n_locks, n_groups, n_tasks;
+	struct sim_lock *locks[LOCK_MAX_LOCKS];
+	struct lock_group *groups[LOCK_MAX_GROUPS];
+	struct task_struct **tasks;
+	u64 start;
+};
+
+struct linsched_locks *linsched_load_locks(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state);
+void linsched_print_lock_report(struct linsched_locks *ls);
+void linsched_destroy_locks(struct linsched_locks *ls);
+
+#endif	/* __LINSCHED_LOCK_H */
@@ -0,0 +1,487 @@
+/* Producer / consumer pipelines for linsched, see linsched_pipeline.h */
+
+#include "linsched.h"
+#include "linsched_pipeline.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+struct pipeline_item {
+	struct list_head list;
+	u64 created;
+	int pending;		/* sinks not done yet */
+	unsigned char arrived[PIPELINE_MAX_STAGES];	/* for joins */
+};
+
+struct pipeline_entry {
+	struct list_head list;
+	struct pipeline_item *item;
+	u64 enqueued;
+};
+
+/* the task data of both sources and workers */
+struct pipeline_worker {
+	struct sleep_run_data sr_data;
+	struct linsched_pipeline *pl;
+	struct pipeline_stage *stage;
+	wait_queue_t wait;
+	int waiting;
+	u64 woken;
+	struct pipeline_item *item;	/* being served, NULL when idle */
+	u64 service;			/* ns of the current item */
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+static void pipeline_complete(struct linsched_pipeline *pl,
+			      struct pipeline_item *item)
+{
+	if (pl->n_latencies == pl->max_latencies) {
+		pl->max_latencies = max(2 * pl->max_latencies, 1024ULL);
+		pl->latencies = realloc(pl->latencies, pl->max_latencies *
+					sizeof(u64));
+		BUG_ON(!pl->latencies);
+	}
+	pl->latencies[pl->n_latencies++] = current_time - item->created;
+	pl->completed++;
+	list_del(&item->list);
+	free(item);
+}
+
+/* hands an item that st is done with to the following stages, waking
+ * one worker of each */
+static void pipeline_forward(struct linsched_pipeline *pl,
+			     struct pipeline_stage *st,
+			     struct pipeline_item *item)
+{
+	int i;
+
+	if (!st->n_out) {
+		if (!--item->pending)
+			pipeline_complete(pl, item);
+		return;
+	}
+
+	for (i = 0; i < st->n_out; i++) {
+		struct pipeline_stage *next = st->out[i];
+		struct pipeline_entry *e;
+
+		/* a join waits for all of its predecessors */
+		if (++item->arrived[next->id] < next->n_in)
+			continue;
+
+		e = malloc(sizeof(*e));
+		BUG_ON(!e);
+		e->item = item;
+		e->enqueued = current_time;
+		list_add_tail(&e->list, &next->queue);
+		next->max_queued = max(next->max_queued, ++next->queued);
+
+		if (st->out_sync[i])
+			wake_up_interruptible_sync(&next->wq);
+		else
+			wake_up_interruptible(&next->wq);
+	}
+}
+
+/* called by __wake_up() for a waiting worker, with the waker current */
+static int pipeline_wake_function(wait_queue_t *wait, unsigned mode,
+				  int sync, void *key)
+{
+	struct pipeline_worker *w =
+		container_of(wait, struct pipeline_worker, wait);
+	struct pipeline_stage *st = w->stage;
+	int this_cpu = smp_processor_id(), cpu;
+
+	if (!autoremove_wake_function(wait, mode, sync, key))
+		return 0;
+
+	/* where select_task_rq() put the wakee, relative to the waker */
+	cpu = task_cpu(w->sr_data.p);
+	st->wakeups++;
+	if (sync)
+		st->sync_wakeups++;
+	if (cpu == this_cpu)
+		st->wake_same_cpu++;
+	else if (cpumask_test_cpu(cpu, cpu_coregroup_mask(this_cpu)))
+		st->wake_same_llc++;
+	else
+		st->wake_remote++;
+	w->woken = current_time;
+	return 1;
+}
+
+static void pipeline_worker_start(struct task_struct *p, void *data)
+{
+	struct pipeline_worker *w = data;
+
+	sleep_run_start(p, &w->sr_data);
+	init_wait(&w->wait);
+	w->wait.private = p;
+	w->wait.func = pipeline_wake_function;
+}
+
+static void pipeline_worker_handle(struct task_struct *p, void *data)
+{
+	struct pipeline_worker *w = data;
+	struct pipeline_stage *st = w->stage;
+	struct pipeline_entry *e;
+
+	if (w->waiting) {
+		finish_wait(&st->wq, &w->wait);
+		w->waiting = 0;
+		if (w->woken)
+			st->wakeup_latency += current_time - w->woken;
+		w->woken = 0;
+	}
+
+	while (1) {
+		if (w->item) {
+			if (!sleep_run_run_for(&w->sr_data, w->service))
+				return;
+			st->items++;
+			st->service_time += w->service;
+			pipeline_forward(w->pl, st, w->item);
+			w->item = NULL;
+		}
+
+		if (list_empty(&st->queue))
+			break;
+		e = list_first_entry(&st->queue, struct pipeline_entry, list);
+		list_del(&e->list);
+		st->queued--;
+		st->queue_wait += current_time - e->enqueued;
+		w->item = e->item;
+		w->service = gen_ns(st->service);
+		free(e);
+	}
+
+	/* nothing to do, block until a predecessor queues an item */
+	hrtimer_try_to_cancel(&w->sr_data.timer);
+	prepare_to_wait_exclusive(&st->wq, &w->wait, TASK_INTERRUPTIBLE);
+	w->waiting = 1;
+	schedule();
+}
+
+/* runs for the cost of an item, hands it on, then sleeps until the
+ * next one arrives */
+static void pipeline_source_handle(struct task_struct *p, void *data)
+{
+	struct pipeline_worker *w = data;
+	struct pipeline_stage *st = w->stage;
+	struct linsched_pipeline *pl = w->pl;
+	struct pipeline_item *item;
+
+	if (!sleep_run_run_for(&w->sr_data, w->service))
+		return;
+
+	item = calloc(1, sizeof(*item));
+	BUG_ON(!item);
+	item->created = current_time;
+	item->pending = pl->n_sinks;
+	list_add_tail(&item->list, &pl->items);
+	pl->created++;
+	st->items++;
+	st->service_time += w->service;
+	pipeline_forward(pl, st, item);
+
+	w->service = gen_ns(st->service);
+	sleep_run_sleep_for(&w->sr_data, TASK_INTERRUPTIBLE,
+			    max(gen_ns(st->interarrival), 1ULL));
+}
+
+static struct pipeline_stage *find_stage(struct linsched_pipeline *pl,
+					 const char *name)
+{
+	int i;
+
+	for (i = 0; i < pl->n_stages; i++)
+		if (!strcmp(pl->stages[i]->name, name))
+			return pl->stages[i];
+	return NULL;
+}
+
+/* returns true if st reaches a stage that is on the current path */
+static int has_cycle(struct pipeline_stage *st, int *state)
+{
+	int i;
+
+	if (state[st->id] == 1)
+		return 1;
+	if (state[st->id] == 2)
+		return 0;
+	state[st->id] = 1;
+	for (i = 0; i < st->n_out; i++)
+		if (has_cycle(st->out[i], state))
+			return 1;
+	state[st->id] = 2;
+	return 0;
+}
+
+static int parse_pipeline_line(struct linsched_pipeline *pl, char *line,
+			       unsigned int *rand_state)
+{
+	struct pipeline_stage *st, *from, *to;
+	char name[32], to_name[32], flag[16] = "";
+	int n, len;
+
+	if (sscanf(line, "EDGE %31s %31s %15s", name, to_name, flag) >= 2) {
+		from = find_stage(pl, name);
+		to = find_stage(pl, to_name);
+		if (!from || !to || to->source ||
+		    from->n_out == PIPELINE_MAX_STAGES ||
+		    (flag[0] && strcmp(flag, "sync")))
+			return -1;
+		for (n = 0; n < from->n_out; n++)
+			if (from->out[n] == to)
+				return -1;
+		from->out_sync[from->n_out] = !strcmp(flag, "sync");
+		from->out[from->n_out++] = to;
+		to->n_in++;
+		return 0;
+	}
+
+	if (pl->n_stages == PIPELINE_MAX_STAGES)
+		return -1;
+	st = calloc(1, sizeof(*st));
+	BUG_ON(!st);
+
+	if (sscanf(line, "SOURCE %31s %d %n", name, &n, &len) >= 2) {
+		line += len;
+		st->source = 1;
+		st->interarrival = linsched_parse_distribution(&line,
+							       rand_state);
+	} else if (sscanf(line, "STAGE %31s %d %n", name, &n, &len) >= 2) {
+		line += len;
+	} else {
+		free(st);
+		return -1;
+	}
+	st->service = linsched_parse_distribution(&line, rand_state);
+	if (n <= 0 || find_stage(pl, name) || !st->service ||
+	    (st->source && !st->interarrival)) {
+		if (st->service)
+			linsched_destroy_dist(st->service);
+		if (st->interarrival)
+			linsched_destroy_dist(st->interarrival);
+		free(st);
+		return -1;
+	}
+
+	strcpy(st->name, name);
+	st->id = pl->n_stages;
+	st->n_tasks = n;
+	init_waitqueue_head(&st->wq);
+	INIT_LIST_HEAD(&st->queue);
+	pl->stages[pl->n_stages++] = st;
+	return 0;
+}
+
+static struct task_struct *create_pipeline_task(struct linsched_pipeline *pl,
+						struct pipeline_stage *st)
+{
+	struct task_data *td = malloc(sizeof(struct task_data));
+	struct pipeline_worker *w = calloc(1, sizeof(*w));
+
+	BUG_ON(!td || !w);
+	w->pl = pl;
+	w->stage = st;
+	sleep_run_init(&w->sr_data);
+	td->data = w;
+	td->init_task = pipeline_worker_start;
+	if (st->source) {
+		w->service = gen_ns(st->service);
+		td->handle_task = pipeline_source_handle;
+	} else {
+		td->handle_task = pipeline_worker_handle;
+	}
+	return linsched_create_normal_task(td, 0);
+}
+
+/* Creates the tasks of a pipeline described by a file of lines
+ *   SOURCE <name> <tasks> <interarrival dist> <cost dist>
+ *   STAGE <name> <workers> <service dist>
+ *   EDGE <from> <to> [sync]
+ * where distributions are in ns, as in linsched_create_sim(). There
+ * must be exactly one SOURCE, every stage must be reachable from it
+ * and the graph must not have cycles. A "sync" edge wakes the worker
+ * of <to> with WF_SYNC. Empty lines and lines starting with '#' are
+ * ignored. */
+struct linsched_pipeline *linsched_load_pipeline(char *filename,
+						 const struct cpumask *cpus,
+						 unsigned int *rand_state)
+{
+	struct linsched_pipeline *pl = calloc(1, sizeof(*pl));
+	struct pipeline_stage *source = NULL;
+	int state[PIPELINE_MAX_STAGES] = {};
+	char line[256];
+	FILE *f;
+	int i, j, lineno = 0;
+
+	BUG_ON(!pl);
+	INIT_LIST_HEAD(&pl->items);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_pipeline_line(pl, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad pipeline line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+
+	for (i = 0; i < pl->n_stages; i++) {
+		struct pipeline_stage *st = pl->stages[i];
+
+		if (st->source) {
+			if (source)
+				goto invalid;
+			source = st;
+		}
+		if (!st->n_out)
+			pl->n_sinks++;
+	}
+	if (!source || !source->n_out || has_cycle(source, state))
+		goto invalid;
+	for (i = 0; i < pl->n_stages; i++)
+		if (!state[i])
+			goto invalid;
+
+	pl->start = current_time;
+	for (i = 0; i < pl->n_stages; i++) {
+		struct pipeline_stage *st = pl->stages[i];
+
+		st->tasks = calloc(st->n_tasks, sizeof(struct task_struct *));
+		BUG_ON(!st->tasks);
+		for (j = 0; j < st->n_tasks; j++) {
+			st->tasks[j] = create_pipeline_task(pl, st);
+			set_cpus_allowed_ptr(st->tasks[j], cpus);
+		}
+	}
+	return pl;
+
+invalid:
+	fprintf(stderr, "%s: a pipeline needs one SOURCE from which all "
+		"stages are reachable, and no cycles\n", filename);
+err:
+	linsched_destroy_pipeline(pl);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(struct linsched_pipeline *pl, double pct)
+{
+	u64 rank = pl->n_latencies * pct / 100;
+
+	if (!pl->n_latencies)
+		return 0;
+	return pl->latencies[min(rank, pl->n_latencies - 1)] / 1000.0;
+}
+
+static double per_item_us(u64 total, u64 n)
+{
+	return n ? total / 1000.0 / n : 0;
+}
+
+void linsched_print_pipeline_report(struct linsched_pipeline *pl)
+{
+	u64 elapsed = current_time - pl->start, sum = 0;
+	int i;
+
+	qsort(pl->latencies, pl->n_latencies, sizeof(u64), u64_compare);
+	for (i = 0; i < pl->n_latencies; i++)
+		sum += pl->latencies[i];
+
+	fprintf(stdout, "------ pipeline\n");
+	fprintf(stdout, "items: created = %llu, completed = %llu, "
+		"in flight = %llu\n", pl->created, pl->completed,
+		pl->created - pl->completed);
+	fprintf(stdout, "throughput: %.1f items/s\n",
+		elapsed ? pl->completed * (double)NSEC_PER_SEC / elapsed : 0);
+	fprintf(stdout, "latency (us): mean = %.1f, p50 = %.1f, p90 = %.1f, "
+		"p99 = %.1f, max = %.1f\n",
+		per_item_us(sum, pl->n_latencies), percentile_us(pl, 50),
+		percentile_us(pl, 90), percentile_us(pl, 99),
+		percentile_us(pl, 100));
+
+	fprintf(stdout, "%-12s %5s %9s %11s %11s %6s %9s %9s %11s "
+		"%8s %8s %8s\n", "stage", "tasks", "items", "service_us",
+		"qwait_us", "maxq", "wakeups", "sync", "wakelat_us",
+		"samecpu%", "samellc%", "remote%");
+	for (i = 0; i < pl->n_stages; i++) {
+		struct pipeline_stage *st = pl->stages[i];
+		double w = st->wakeups ? 100.0 / st->wakeups : 0;
+
+		fprintf(stdout, "%-12s %5d %9llu %11.1f %11.1f %6d %9llu %9llu "
+			"%11.1f %8.1f %8.1f %8.1f\n", st->name, st->n_tasks,
+			st->items, per_item_us(st->service_time, st->items),
+			per_item_us(st->queue_wait, st->items),
+			st->max_queued, st->wakeups, st->sync_wakeups,
+			per_item_us(st->wakeup_latency, st->wakeups),
+			st->wake_same_cpu * w, st->wake_same_llc * w,
+			st->wake_remote * w);
+	}
+}
+
+void linsched_destroy_pipeline(struct linsched_pipeline *pl)
+{
+	struct pipeline_item *item, *tmp_item;
+	struct pipeline_entry *e, *tmp;
+	int i, j;
+
+	if (!pl)
+		return;
+
+	for (i = 0; i < pl->n_stages; i++) {
+		struct pipeline_stage *st = pl->stages[i];
+
+		for (j = 0; st->tasks && j < st->n_tasks; j++) {
+			struct thread_info *ti = task_thread_info(st->tasks[j]);
+			struct pipeline_worker *w = ti->td->data;
+
+			hrtimer_cancel(&w->sr_data.timer);
+			free(w);
+			free(ti->td);
+			ti->td = NULL;
+		}
+		list_for_each_entry_safe(e, tmp, &st->queue, list)
+			free(e);
+		linsched_destroy_dist(st->service);
+		if (st->interarrival)
+			linsched_destroy_dist(st->interarrival);
+		free(st->tasks);
+		free(st);
+	}
+	list_for_each_entry_safe(item, tmp_item, &pl->items, list)
+		free(item);
+	free(pl->latencies);
+	free(pl);
+}
@@ -0,0 +1,67 @@
+/* Producer / consumer pipelines for linsched
+ *
+ * A pipeline is a graph of stages connected by queues. Source tasks
+ * produce items at random intervals; each stage has a pool of worker
+ * tasks that block on the wait queue of the stage's item queue, and
+ * whoever finishes an item wakes a worker of each following stage.
+ * Unlike the sleep / run task models, whose tasks are only ever woken
+ * by their own timers, this exercises the wakeup path between tasks:
+ * wake_affine(), select_idle_sibling() and, on "sync" edges, WF_SYNC
+ * wakeups.
+ *
+ * A stage with several successors fans each item out to all of them;
+ * a stage with several predecessors joins, i.e. only queues an item
+ * once every predecessor is done with it. An item completes when all
+ * stages without successors are done with it, and its end to end
+ * latency is measured from the time the source produced it.
+ */
+
+#ifndef __LINSCHED_PIPELINE_H
+#define __LINSCHED_PIPELINE_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define PIPELINE_MAX_STAGES 32
+
+struct pipeline_stage {
+	char name[32];
+	int id;
+	int source;		/* produces items, no queue */
+	int n_tasks;
+	struct task_struct **tasks;
+	struct rand_dist *service;	/* ns per item */
+	struct rand_dist *interarrival;	/* ns, sources only */
+
+	int n_in, n_out;
+	struct pipeline_stage *out[PIPELINE_MAX_STAGES];
+	int out_sync[PIPELINE_MAX_STAGES];
+
+	wait_queue_head_t wq;
+	struct list_head queue;
+	int queued, max_queued;
+
+	/* stats */
+	u64 items, service_time, queue_wait;
+	u64 wakeups, sync_wakeups, wakeup_latency;
+	u64 wake_same_cpu, wake_same_llc, wake_remote;
+};
+
+struct linsched_pipeline {
+	int n_stages, n_sinks;
+	struct pipeline_stage *stages[PIPELINE_MAX_STAGES];
+	struct list_head items;	/* in flight */
+	u64 start;
+
+	u64 created, completed;
+	u64 *latencies;		/* of completed items, ns */
+	u64 n_latencies, max_latencies;
+};
+
+struct linsched_pipeline *linsched_load_pipeline(char *filename,
+						 const struct cpumask *cpus,
+						 unsigned int *rand_state);
+void linsched_print_pipeline_report(struct linsched_pipeline *pl);
+void linsched_destroy_pipeline(struct linsched_pipeline *pl);
+
+#endif	/* __LINSCHED_PIPELINE_H */
@@ -0,0 +1,502 @@
+/* Work-stealing thread pools for linsched, see linsched_pool.h */
+
+#include "linsched.h"
+#include "linsched_pool.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+enum { WORKER_BUSY, WORKER_SPINNING, WORKER_PARKED };
+
+struct pool_job {
+	struct list_head list;
+	u64 enqueued, exec;
+	int root;			/* injected, may spawn children */
+};
+
+struct pool_worker {
+	struct sleep_run_data sr_data;
+	struct work_pool *pool;
+	struct task_struct *p;
+	struct list_head deque;		/* the owner's end is the head */
+	struct pool_job *job;		/* running, or NULL */
+	int state, round;
+	/* cpu time at the start of a spin */
+	u64 spin_start;
+	/* on the spinning or parked list */
+	struct list_head idle;
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+/* of w, which must be current */
+static u64 worker_cpu_time(struct pool_worker *w)
+{
+	struct task_struct *p = w->p;
+
+	return task_exec_time(p) + linsched_rq_clock_task(task_cpu(p)) -
+		p->se.exec_start;
+}
+
+/* makes a spinning worker look for work now, on its cpu */
+static void pool_poke(struct pool_worker *w)
+{
+	int old_cpu = smp_processor_id();
+
+	w->pool->pokes++;
+	linsched_change_cpu(task_cpu(w->p));
+	hrtimer_start(&w->sr_data.timer, ns_to_ktime(1),
+		      HRTIMER_MODE_REL_PINNED);
+	linsched_change_cpu(old_cpu);
+}
+
+/* new work: a spinning worker will find it, or else wake a parked one */
+static void pool_notify(struct work_pool *pool)
+{
+	struct pool_worker *w;
+	int this_cpu = smp_processor_id(), cpu;
+	struct task_struct *curr;
+
+	if (!list_empty(&pool->spinning)) {
+		pool_poke(list_first_entry(&pool->spinning,
+					   struct pool_worker, idle));
+		return;
+	}
+	if (list_empty(&pool->parked))
+		return;
+
+	w = list_first_entry(&pool->parked, struct pool_worker, idle);
+	list_del_init(&w->idle);
+	w->state = WORKER_BUSY;
+	pool->wakeups++;
+	wake_up_process(w->p);
+
+	cpu = task_cpu(w->p);
+	if (cpu == this_cpu)
+		pool->wake_same_cpu++;
+	else if (cpumask_test_cpu(cpu, cpu_coregroup_mask(this_cpu)))
+		pool->wake_same_llc++;
+	else
+		pool->wake_remote++;
+	curr = cpu_curr(cpu);
+	if (curr != idle_task(cpu) && curr != w->p &&
+	    test_tsk_need_resched(curr))
+		pool->wake_preempt++;
+}
+
+static struct pool_job *pool_new_job(struct work_pool *pool, int root)
+{
+	struct pool_job *job = malloc(sizeof(*job));
+
+	BUG_ON(!job);
+	job->enqueued = current_time;
+	job->exec = gen_ns(pool->exec);
+	job->root = root;
+	pool->queued++;
+	return job;
+}
+
+static enum hrtimer_restart pool_arrival(struct hrtimer *timer)
+{
+	struct work_pool *pool = container_of(timer, struct work_pool, timer);
+
+	list_add_tail(&pool_new_job(pool, 1)->list, &pool->injector);
+	pool->injected++;
+	pool_notify(pool);
+
+	hrtimer_add_expires_ns(timer, max(gen_ns(pool->arrival), 1ULL));
+	return HRTIMER_RESTART;
+}
+
+static void stop_spinning(struct pool_worker *w)
+{
+	struct work_pool *pool = w->pool;
+
+	if (w->state != WORKER_SPINNING)
+		return;
+	pool->spin_time += worker_cpu_time(w) - w->spin_start;
+	list_del_init(&w->idle);
+	w->state = WORKER_BUSY;
+	/* abandon the current spin round */
+	w->sr_data.last_start = 0;
+}
+
+/* own deque, then the injector, then a steal starting at a random peer */
+static struct pool_job *find_work(struct pool_worker *w)
+{
+	struct work_pool *pool = w->pool;
+	struct pool_job *job = NULL;
+	int i, n = pool->n_workers;
+	int first = (int)(linsched_rand(pool->rand_state) * n) % n;
+
+	if (!list_empty(&w->deque)) {
+		job = list_first_entry(&w->deque, struct pool_job, list);
+		pool->from_own++;
+	} else if (!list_empty(&pool->injector)) {
+		job = list_first_entry(&pool->injector, struct pool_job,
+				       list);
+		pool->from_injector++;
+	} else {
+		for (i = 0; i < n && !job; i++) {
+			struct pool_worker *v = pool->workers[(first + i) % n];
+
+			if (v == w || list_empty(&v->deque))
+				continue;
+			job = list_entry(v->deque.prev, struct pool_job, list);
+			pool->stolen++;
+		}
+	}
+	if (job) {
+		list_del(&job->list);
+		pool->queued--;
+	}
+	return job;
+}
+
+static void start_job(struct pool_worker *w, struct pool_job *job)
+{
+	struct work_pool *pool = w->pool;
+	int i, last_spinner;
+
+	last_spinner = w->state == WORKER_SPINNING &&
+		list_is_singular(&pool->spinning);
+	stop_spinning(w);
+	w->job = job;
+	pool->queue_wait += current_time - job->enqueued;
+
+	/* the last worker to stop looking makes sure someone still is */
+	if (last_spinner && pool->queued)
+		pool_notify(pool);
+
+	for (i = 0; job->root && i < pool->spawn; i++) {
+		list_add(&pool_new_job(pool, 0)->list, &w->deque);
+		pool->spawned++;
+		pool_notify(pool);
+	}
+}
+
+static void job_done(struct pool_worker *w)
+{
+	struct work_pool *pool = w->pool;
+	struct pool_job *job = w->job;
+
+	if (pool->completed == pool->max_latencies) {
+		pool->max_latencies = max(2 * pool->max_latencies, 1024ULL);
+		pool->latencies = realloc(pool->latencies,
+					  pool->max_latencies * sizeof(u64));
+		BUG_ON(!pool->latencies);
+	}
+	pool->latencies[pool->completed++] = current_time - job->enqueued;
+	pool->useful_time += job->exec;
+	w->job = NULL;
+	free(job);
+}
+
+static void pool_worker_start(struct task_struct *p, void *data)
+{
+	struct pool_worker *w = data;
+
+	w->p = p;
+	sleep_run_start(p, &w->sr_data);
+}
+
+static void pool_worker_handle(struct task_struct *p, void *data)
+{
+	struct pool_worker *w = data;
+	struct work_pool *pool = w->pool;
+	struct pool_job *job;
+
+	for (;;) {
+		if (w->job) {
+			if (!sleep_run_run_for(&w->sr_data, w->job->exec))
+				return;
+			job_done(w);
+		}
+
+		job = find_work(w);
+		if (job) {
+			start_job(w, job);
+			continue;
+		}
+
+		if (w->state != WORKER_SPINNING) {
+			w->state = WORKER_SPINNING;
+			w->round = 0;
+			w->spin_start = worker_cpu_time(w);
+			list_add_tail(&w->idle, &pool->spinning);
+		}
+		if (!sleep_run_run_for(&w->sr_data,
+				       pool->spin / POOL_SPIN_ROUNDS))
+			return;
+		if (++w->round < POOL_SPIN_ROUNDS) {
+			pool->yields++;
+			linsched_yield();
+			/* runs again from its next call if others ran */
+			if (current != p)
+				return;
+			continue;
+		}
+
+		/* nothing came up, park until new work wakes it */
+		stop_spinning(w);
+		hrtimer_try_to_cancel(&w->sr_data.timer);
+		w->state = WORKER_PARKED;
+		list_add(&w->idle, &pool->parked);
+		pool->parks++;
+		p->state = TASK_INTERRUPTIBLE;
+		schedule();
+		return;
+	}
+}
+
+static int parse_pool_line(struct linsched_pools *ps, char *line,
+			   unsigned int *rand_state)
+{
+	char name[32], path[128];
+	struct work_pool *pool;
+	int n, spawn, len, i;
+	u64 spin;
+
+	if (sscanf(line, "POOL %31s %d %127s %llu %d %n", name, &n, path,
+		   &spin, &spawn, &len) < 5 || ps->n_pools == POOL_MAX_POOLS ||
+	    n <= 0 || spawn < 0 || path[0] != '/')
+		return -1;
+	for (i = 0; i < ps->n_pools; i++)
+		if (!strcmp(ps->pools[i]->name, name))
+			return -1;
+
+	pool = calloc(1, sizeof(*pool));
+	BUG_ON(!pool);
+	ps->pools[ps->n_pools++] = pool;
+	strcpy(pool->name, name);
+	pool->n_workers = n;
+	pool->spin = spin;
+	pool->spawn = spawn;
+	pool->cg = linsched_find_cgroup(path, 1);
+	pool->rand_state = rand_state;
+	INIT_LIST_HEAD(&pool->injector);
+	INIT_LIST_HEAD(&pool->spinning);
+	INIT_LIST_HEAD(&pool->parked);
+	hrtimer_init(&pool->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pool->timer.function = pool_arrival;
+
+	line += len;
+	pool->arrival = linsched_parse_distribution(&line, rand_state);
+	if (pool->arrival)
+		pool->exec = linsched_parse_distribution(&line, rand_state);
+	return pool->exec ? 0 : -1;
+}
+
+/* Creates the pools described by a file of lines
+ *   POOL <name> <workers> <cgroup> <spin ns> <spawn> <arrival dist>
+ *        <job dist>
+ * (on one line) where the distributions are in ns, as in
+ * linsched_create_sim(). Each injected job spawns <spawn> children
+ * with the same job distribution when it starts, and a worker spins
+ * for <spin ns> of cpu time before it parks. Empty lines and lines
+ * starting with '#' are ignored.
+ *
+ * Jobs are injected from timers on the first of cpus, like requests
+ * coming in from a single queue NIC. */
+struct linsched_pools *linsched_load_pools(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state)
+{
+	struct linsched_pools *ps = calloc(1, sizeof(*ps));
+	int old_cpu = smp_processor_id();
+	char line[256];
+	FILE *f;
+	int i, j, lineno = 0;
+
+	BUG_ON(!ps);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_pool_line(ps, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad pool line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!ps->n_pools) {
+		fprintf(stderr, "%s: no POOL lines\n", filename);
+		goto err;
+	}
+
+	for (i = 0; i < ps->n_pools; i++) {
+		struct work_pool *pool = ps->pools[i];
+
+		pool->workers = calloc(pool->n_workers, sizeof(*pool->workers));
+		BUG_ON(!pool->workers);
+		for (j = 0; j < pool->n_workers; j++) {
+			struct task_data *td = malloc(sizeof(struct task_data));
+			struct pool_worker *w = calloc(1, sizeof(*w));
+			struct task_struct *p;
+
+			BUG_ON(!td || !w);
+			w->pool = pool;
+			INIT_LIST_HEAD(&w->deque);
+			INIT_LIST_HEAD(&w->idle);
+			sleep_run_init(&w->sr_data);
+			pool->workers[j] = w;
+			td->data = w;
+			td->init_task = pool_worker_start;
+			td->handle_task = pool_worker_handle;
+			p = linsched_create_normal_task(td, 0);
+			set_cpus_allowed_ptr(p, cpus);
+			linsched_add_task_to_group(p, pool->cg);
+		}
+
+		pool->start = current_time;
+		linsched_change_cpu(cpumask_first(cpus));
+		hrtimer_start(&pool->timer,
+			      ns_to_ktime(max(gen_ns(pool->arrival), 1ULL)),
+			      HRTIMER_MODE_REL);
+		linsched_change_cpu(old_cpu);
+	}
+	return ps;
+
+err:
+	linsched_destroy_pools(ps);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(struct work_pool *pool, double pct)
+{
+	u64 n = pool->completed;
+
+	if (!n)
+		return 0;
+	return pool->latencies[min((u64)(n * pct / 100), n - 1)] / 1000.0;
+}
+
+static double pct_of(u64 x, u64 total)
+{
+	return total ? 100.0 * x / total : 0;
+}
+
+void linsched_print_pool_report(struct linsched_pools *ps)
+{
+	int i;
+
+	fprintf(stdout, "------ pool\n");
+	fprintf(stdout, "%-12s %7s %9s %9s %9s %9s %9s %9s %7s %7s %7s\n",
+		"pool", "workers", "jobs", "jobs/s", "lat_avg", "lat_p50",
+		"lat_p99", "lat_max", "own%", "inj%", "stolen%");
+	for (i = 0; i < ps->n_pools; i++) {
+		struct work_pool *pool = ps->pools[i];
+		u64 elapsed = current_time - pool->start, sum = 0, j;
+		u64 found = pool->from_own + pool->from_injector + pool->stolen;
+
+		qsort(pool->latencies, pool->completed, sizeof(u64),
+		      u64_compare);
+		for (j = 0; j < pool->completed; j++)
+			sum += pool->latencies[j];
+		fprintf(stdout, "%-12s %7d %9llu %9.1f %9.1f %9.1f %9.1f "
+			"%9.1f %7.1f %7.1f %7.1f\n", pool->name,
+			pool->n_workers, pool->completed,
+			elapsed ? pool->completed * (double)NSEC_PER_SEC /
+			elapsed : 0,
+			pool->completed ? sum / 1000.0 / pool->completed : 0,
+			percentile_us(pool, 50), percentile_us(pool, 99),
+			percentile_us(pool, 100),
+			pct_of(pool->from_own, found),
+			pct_of(pool->from_injector, found),
+			pct_of(pool->stolen, found));
+	}
+
+	fprintf(stdout, "%-12s %10s %10s %6s %9s %9s %9s %9s %9s %7s %7s "
+		"%7s %8s\n", "pool", "useful_ms", "spin_ms", "eff%", "wait_us",
+		"yields", "parks", "pokes", "wakeups", "wcpu%", "wllc%",
+		"wrem%", "wpreempt");
+	for (i = 0; i < ps->n_pools; i++) {
+		struct work_pool *pool = ps->pools[i];
+		u64 found = pool->from_own + pool->from_injector + pool->stolen;
+
+		fprintf(stdout, "%-12s %10.1f %10.1f %6.1f %9.1f %9llu %9llu "
+			"%9llu %9llu %7.1f %7.1f %7.1f %8llu\n", pool->name,
+			pool->useful_time / 1e6, pool->spin_time / 1e6,
+			pct_of(pool->useful_time,
+			       pool->useful_time + pool->spin_time),
+			found ? pool->queue_wait / 1000.0 / found : 0,
+			pool->yields, pool->parks, pool->pokes,
+			pool->wakeups,
+			pct_of(pool->wake_same_cpu, pool->wakeups),
+			pct_of(pool->wake_same_llc, pool->wakeups),
+			pct_of(pool->wake_remote, pool->wakeups),
+			pool->wake_preempt);
+	}
+}
+
+static void free_jobs(struct list_head *head)
+{
+	struct pool_job *job, *n;
+
+	list_for_each_entry_safe(job, n, head, list) {
+		list_del(&job->list);
+		free(job);
+	}
+}
+
+void linsched_destroy_pools(struct linsched_pools *ps)
+{
+	int i, j;
+
+	if (!ps)
+		return;
+
+	for (i = 0; i < ps->n_pools; i++) {
+		struct work_pool *pool = ps->pools[i];
+
+		hrtimer_cancel(&pool->timer);
+		for (j = 0; pool->workers && j < pool->n_workers; j++) {
+			struct pool_worker *w = pool->workers[j];
+			struct thread_info *ti = task_thread_info(w->p);
+
+			hrtimer_cancel(&w->sr_data.timer);
+			free_jobs(&w->deque);
+			free(w->job);
+			free(ti->td);
+			ti->td = NULL;
+			free(w);
+		}
+		free_jobs(&pool->injector);
+		if (pool->arrival)
+			linsched_destroy_dist(pool->arrival);
+		if (pool->exec)
+			linsched_destroy_dist(pool->exec);
+		free(pool->workers);
+		free(pool->latencies);
+		free(pool);
+	}
+	free(ps);
+}
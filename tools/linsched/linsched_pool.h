@@ -0,0 +1,68 @@
+/* Work-stealing thread pools for linsched
+ *
+ * Models the runtimes of rayon, tokio, Go or ForkJoinPool: a pool of
+ * worker tasks runs jobs that arrive in an injection queue at intervals
+ * drawn from a distribution. A job may spawn children, which go to the
+ * front of the deque of the worker running it; an idle worker takes
+ * the front of its own deque, then the oldest injected job, then steals
+ * from the back of the deque of another worker. A worker that finds
+ * nothing spins for a while, in rounds with a sched_yield() between
+ * them, and then parks. New work goes to a spinning worker if there is
+ * one, and otherwise wakes a parked worker from the cpu that queued it,
+ * which is what makes select_idle_sibling(), wake_affine() and wakeup
+ * preemption matter for these runtimes.
+ *
+ * The report gives the job latencies, how the jobs were found (own
+ * deque, injection queue, stolen), the cpu efficiency of the workers
+ * (useful work against time spent spinning), and where the parked
+ * workers were woken.
+ */
+
+#ifndef __LINSCHED_POOL_H
+#define __LINSCHED_POOL_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define POOL_MAX_POOLS 8
+#define POOL_SPIN_ROUNDS 4
+
+struct pool_worker;
+
+struct work_pool {
+	char name[32];
+	int n_workers, spawn;
+	struct cgroup *cg;
+	u64 spin;			/* ns spun before parking */
+	struct rand_dist *arrival;	/* ns between injected jobs */
+	struct rand_dist *exec;		/* ns of cpu time of a job */
+	struct pool_worker **workers;
+	unsigned int *rand_state;	/* picks the first steal victim */
+
+	struct list_head injector;
+	int queued;			/* in the injector and the deques */
+	struct list_head spinning, parked;
+	struct hrtimer timer;
+	u64 start;
+
+	/* stats */
+	u64 injected, spawned, completed;
+	u64 from_own, from_injector, stolen;
+	u64 useful_time, spin_time, queue_wait;
+	u64 yields, parks, pokes, wakeups;
+	u64 wake_same_cpu, wake_same_llc, wake_remote, wake_preempt;
+	u64 *latencies, max_latencies;	/* enqueue to completion, ns */
+};
+
+struct linsched_pools {
+	int n_pools;
+	struct work_pool *pools[POOL_MAX_POOLS];
+};
+
+struct linsched_pools *linsched_load_pools(char *filename,
+					   const struct cpumask *cpus,
+					   unsigned int *rand_state);
+void linsched_print_pool_report(struct linsched_pools *ps);
+void linsched_destroy_pools(struct linsched_pools *ps);
+
+#endif	/* __LINSCHED_POOL_H */
@@ -5,6 +5,9 @@
 #include "linsched_rand.h"
 #include <math.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 
 /* seed the linsched_rand()
  * XORing with MASK to allow seed to be 0 */
@@ -279,6 +282,281 @@ void linsched_destroy_lognormal(struct rand_dist *rdist)
 
 }
 
+/* samples an empirical distribution in O(1) using Walker's alias
+ * method: pick a column uniformly, then keep it or take its alias.
+ * Both choices come from one deviate, as successive Lehmer deviates
+ * are correlated. Bins with a width are sampled uniformly within
+ * the bin */
+double linsched_gen_empirical_dist(struct rand_dist *rdist)
+{
+	struct empirical_dist *edist = rdist->dist;
+	struct empirical_table *t = edist->table;
+	unsigned int *rand_state = edist->rand_state;
+	double x = linsched_rand(rand_state) * t->n;
+	int i = x;
+
+	if (i >= t->n)
+		i = t->n - 1;
+	if (x - i >= t->prob[i])
+		i = t->alias[i];
+	if (t->hi[i] == t->lo[i])
+		return t->lo[i];
+	return linsched_rand_range(t->lo[i], t->hi[i], rand_state);
+}
+
+/* builds the alias tables (ref. Vose, "A linear algorithm for
+ * generating random numbers with a given distribution", 1991) */
+static struct empirical_table *build_empirical_table(const double *lo,
+						     const double *hi,
+						     const double *weights,
+						     const int n)
+{
+	struct empirical_table *t;
+	double *scaled;
+	int *small, *large;
+	int i, n_small = 0, n_large = 0;
+	double total = 0, mean = 0;
+
+	for (i = 0; i < n; i++)
+		if (weights[i] > 0)
+			total += weights[i];
+	if (n <= 0 || total <= 0)
+		return NULL;
+
+	t = malloc(sizeof(struct empirical_table));
+	t->n = n;
+	t->lo = malloc(n * sizeof(double));
+	t->hi = malloc(n * sizeof(double));
+	t->prob = malloc(n * sizeof(double));
+	t->alias = malloc(n * sizeof(int));
+	t->refcount = 1;
+	scaled = malloc(n * sizeof(double));
+	small = malloc(n * sizeof(int));
+	large = malloc(n * sizeof(int));
+
+	for (i = 0; i < n; i++) {
+		double w = weights[i] > 0 ? weights[i] : 0;
+
+		t->lo[i] = lo[i];
+		t->hi[i] = hi ? hi[i] : lo[i];
+		t->alias[i] = i;
+		mean += w / total * (t->lo[i] + t->hi[i]) / 2;
+		scaled[i] = w * n / total;
+		if (scaled[i] < 1.0)
+			small[n_small++] = i;
+		else
+			large[n_large++] = i;
+	}
+	t->mean = mean;
+
+	while (n_small && n_large) {
+		int s = small[--n_small];
+		int l = large[--n_large];
+
+		t->prob[s] = scaled[s];
+		t->alias[s] = l;
+		scaled[l] -= 1.0 - scaled[s];
+		if (scaled[l] < 1.0)
+			small[n_small++] = l;
+		else
+			large[n_large++] = l;
+	}
+	/* whatever is left over is 1 up to rounding error */
+	while (n_large)
+		t->prob[large[--n_large]] = 1.0;
+	while (n_small)
+		t->prob[small[--n_small]] = 1.0;
+
+	free(scaled);
+	free(small);
+	free(large);
+	return t;
+}
+
+static struct rand_dist *empirical_from_table(struct empirical_table *t,
+					      const int seed)
+{
+	struct rand_dist *rdist = malloc(sizeof(struct rand_dist));
+	struct empirical_dist *edist = malloc(sizeof(struct empirical_dist));
+
+	edist->table = t;
+	edist->rand_state = linsched_init_rand(seed);
+	rdist->type = EMPIRICAL;
+	rdist->gen_fn = linsched_gen_empirical_dist;
+	rdist->dist = edist;
+	return rdist;
+}
+
+/* creates an empirical distribution from n weighted bins. hi may be
+ * NULL, in which case every entry is the single value lo[i] */
+struct rand_dist *linsched_init_empirical(const double *lo, const double *hi,
+					  const double *weights, const int n,
+					  const int seed)
+{
+	struct empirical_table *t = build_empirical_table(lo, hi, weights, n);
+
+	if (!t)
+		return NULL;
+	return empirical_from_table(t, seed);
+}
+
+/* growable arrays for the file loaders */
+struct empirical_bins {
+	int n, size;
+	double *lo, *hi, *w;
+};
+
+static void add_bin(struct empirical_bins *b, double lo, double hi, double w)
+{
+	if (b->n == b->size) {
+		b->size = b->size ? 2 * b->size : 64;
+		b->lo = realloc(b->lo, b->size * sizeof(double));
+		b->hi = realloc(b->hi, b->size * sizeof(double));
+		b->w = realloc(b->w, b->size * sizeof(double));
+	}
+	b->lo[b->n] = lo;
+	b->hi[b->n] = hi;
+	b->w[b->n] = w;
+	b->n++;
+}
+
+static void free_bins(struct empirical_bins *b)
+{
+	free(b->lo);
+	free(b->hi);
+	free(b->w);
+}
+
+/* loads an empirical distribution from a histogram or CDF file.
+ * Blank lines and lines starting with '#' are ignored. A histogram
+ * has one entry per line, either "<value> <weight>" for a point mass
+ * or "<low> <high> <weight>" for a bin sampled uniformly. A file
+ * whose first entry is the line "CDF" instead lists
+ * "<value> <cumulative probability>" in increasing order; the CDF is
+ * interpolated linearly between consecutive points.
+ * Returns NULL if the file can't be read or holds no weight. */
+struct rand_dist *linsched_load_empirical(const char *filename,
+					  const int seed)
+{
+	FILE *fp = fopen(filename, "r");
+	struct empirical_bins bins = {};
+	struct rand_dist *rdist;
+	char line[256];
+	int cdf = 0, first = 1;
+	double prev_v = 0, prev_c = 0;
+
+	if (!fp)
+		return NULL;
+
+	while (fgets(line, sizeof(line), fp)) {
+		double a, b, c;
+		int nr;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (first && !strncmp(line, "CDF", 3)) {
+			cdf = 1;
+			continue;
+		}
+		nr = sscanf(line, "%lf %lf %lf", &a, &b, &c);
+		if (cdf && nr >= 2) {
+			if (first && b > 0)
+				add_bin(&bins, a, a, b);
+			else if (!first)
+				add_bin(&bins, prev_v, a, b - prev_c);
+			prev_v = a;
+			prev_c = b;
+		} else if (nr == 2) {
+			add_bin(&bins, a, a, b);
+		} else if (nr == 3) {
+			add_bin(&bins, a, b, c);
+		} else {
+			continue;
+		}
+		first = 0;
+	}
+	fclose(fp);
+
+	rdist = linsched_init_empirical(bins.lo, bins.hi, bins.w, bins.n, seed);
+	free_bins(&bins);
+	return rdist;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* builds an empirical distribution from the durations of one event
+ * type ('R', 'S' or 'D' for iowait) in a pid.rlog file, with one
+ * point mass per distinct duration */
+struct rand_dist *linsched_load_empirical_rlog(const char *filename,
+					       const char event,
+					       const int seed)
+{
+	FILE *fp = fopen(filename, "r");
+	struct empirical_bins bins = {};
+	struct rand_dist *rdist;
+	double *vals = NULL;
+	int n = 0, size = 0, i;
+	char line[256];
+
+	if (!fp)
+		return NULL;
+
+	while (fgets(line, sizeof(line), fp)) {
+		char *type, *duration;
+
+		if (!strtok(line, ",") || !(type = strtok(NULL, ",")) ||
+		    !strtok(NULL, ",") || !(duration = strtok(NULL, ",")))
+			continue;
+		if (toupper(type[0]) != toupper(event))
+			continue;
+		if (n == size) {
+			size = size ? 2 * size : 1024;
+			vals = realloc(vals, size * sizeof(double));
+		}
+		vals[n++] = strtod(duration, NULL);
+	}
+	fclose(fp);
+
+	qsort(vals, n, sizeof(double), cmp_double);
+	for (i = 0; i < n; i++) {
+		if (bins.n && bins.lo[bins.n - 1] == vals[i])
+			bins.w[bins.n - 1]++;
+		else
+			add_bin(&bins, vals[i], vals[i], 1);
+	}
+	free(vals);
+
+	rdist = linsched_init_empirical(bins.lo, bins.hi, bins.w, bins.n, seed);
+	free_bins(&bins);
+	return rdist;
+}
+
+void linsched_destroy_empirical(struct rand_dist *rdist)
+{
+	struct empirical_dist *edist;
+
+	if (rdist) {
+		if (rdist->dist) {
+			edist = rdist->dist;
+			if (!--edist->table->refcount) {
+				free(edist->table->lo);
+				free(edist->table->hi);
+				free(edist->table->prob);
+				free(edist->table->alias);
+				free(edist->table);
+			}
+			linsched_destroy_rand(edist->rand_state);
+			free(edist);
+		}
+		free(rdist);
+	}
+}
+
 void linsched_destroy_dist(struct rand_dist *rdist)
 {
        switch (rdist->type) {
@@ -294,6 +572,9 @@ void linsched_destroy_dist(struct rand_dist *rdist)
        case LOGNORMAL:
                linsched_destroy_lognormal(rdist);
                break;
+       case EMPIRICAL:
+               linsched_destroy_empirical(rdist);
+               break;
        }
 }
 
@@ -320,6 +601,11 @@ struct rand_dist *linsched_copy_dist(const struct rand_dist *rdist,
 		return linsched_init_lognormal(dist->meanlog, dist->sdlog,
 					       *rand_state);
 	}
+	case EMPIRICAL: {
+		struct empirical_dist *dist = rdist->dist;
+		dist->table->refcount++;
+		return empirical_from_table(dist->table, *rand_state);
+	}
 	default:
 		return NULL;
 	}
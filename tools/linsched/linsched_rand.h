@@ -12,6 +12,8 @@ enum RND_TYPE {
 	EXPONENTIAL,
 	LOGNORMAL,
 	MAX_RND_TYPE = LOGNORMAL,
+	/* never picked at random, it needs a histogram to sample from */
+	EMPIRICAL,
 };
 
 struct rand_dist {
@@ -40,6 +42,23 @@ struct lognormal_dist {
 	struct rand_dist *std_gauss_dist;
 };
 
+/* Walker alias tables for an empirical distribution. Entry i is the
+ * bin [lo[i], hi[i]), or the single value lo[i] when lo[i] == hi[i].
+ * Tables are shared (refcounted) between copies of a distribution. */
+struct empirical_table {
+	int n;
+	double *lo, *hi;
+	double *prob;
+	int *alias;
+	double mean;
+	int refcount;
+};
+
+struct empirical_dist {
+	struct empirical_table *table;
+	unsigned int *rand_state;
+};
+
 int *linsched_init_rand(const unsigned int seed);
 void linsched_destroy_rand(unsigned int *state);
 double linsched_rand(unsigned int *const state);
@@ -62,6 +81,16 @@ void linsched_destroy_exponential(struct rand_dist *rdist);
 struct rand_dist *linsched_init_lognormal(const double meanlog,
 					const double sdlog, const int seed);
 void linsched_destroy_lognormal(struct rand_dist *rdist);
+double linsched_gen_empirical_dist(struct rand_dist *rdist);
+struct rand_dist *linsched_init_empirical(const double *lo, const double *hi,
+					  const double *weights, const int n,
+					  const int seed);
+struct rand_dist *linsched_load_empirical(const char *filename,
+					  const int seed);
+struct rand_dist *linsched_load_empirical_rlog(const char *filename,
+					       const char event,
+					       const int seed);
+void linsched_destroy_empirical(struct rand_dist *rdist);
 void linsched_destroy_dist(struct rand_dist *rdist);
 
 #endif				/* __LINSCHED_RAND_H */
@@ -0,0 +1,317 @@
+/* Periodic real-time tasks for linsched, see linsched_rt.h */
+
+#include "linsched.h"
+#include "linsched_rt.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+static u64 next_release(struct rt_task *t)
+{
+	u64 delay = t->g->period;
+
+	if (t->g->sporadic)
+		delay += gen_ns(t->g->sporadic);
+	return t->release + delay;
+}
+
+static void rt_job_done(struct rt_task *t)
+{
+	u64 resp = current_time - t->release;
+
+	if (t->n_resp == t->max_resp) {
+		t->max_resp = max(2 * t->max_resp, 1024ULL);
+		t->resp = realloc(t->resp, t->max_resp * sizeof(u64));
+		BUG_ON(!t->resp);
+	}
+	t->resp[t->n_resp++] = resp;
+	t->jobs++;
+	if (resp > t->g->deadline)
+		t->misses++;
+}
+
+static void rt_task_start(struct task_struct *p, void *data)
+{
+	struct rt_task *t = data;
+
+	sleep_run_start(p, &t->sr_data);
+}
+
+/* runs a job per release, sleeping until the next one once it is done */
+static void rt_task_handle(struct task_struct *p, void *data)
+{
+	struct rt_task *t = data;
+
+	for (;;) {
+		if (current_time < t->release) {
+			sleep_run_sleep_for(&t->sr_data, TASK_INTERRUPTIBLE,
+					    t->release - current_time);
+			return;
+		}
+		if (!t->started) {
+			u64 start = current_time - t->release;
+
+			t->started = 1;
+			t->start_sum += start;
+			t->start_max = max(t->start_max, start);
+		}
+		if (!sleep_run_run_for(&t->sr_data, t->exec))
+			return;
+
+		rt_job_done(t);
+		t->started = 0;
+		t->release = next_release(t);
+		t->exec = gen_ns(t->g->exec);
+	}
+}
+
+static int parse_rt_line(struct linsched_rt *rt, char *line,
+			 unsigned int *rand_state)
+{
+	char name[32], policy[8], cpus[64], deadline[24];
+	struct rt_group *g;
+	int n, prio, len;
+	u64 period;
+
+	if (sscanf(line, "RT %31s %d %7s %d %63s %llu %23s %n", name, &n,
+		   policy, &prio, cpus, &period, deadline, &len) < 7 ||
+	    rt->n_groups == RT_MAX_GROUPS || n <= 0 || !period ||
+	    prio < 1 || prio >= MAX_USER_RT_PRIO)
+		return -1;
+
+	g = calloc(1, sizeof(*g));
+	BUG_ON(!g);
+	rt->groups[rt->n_groups++] = g;
+	strcpy(g->name, name);
+	g->n_tasks = n;
+	g->prio = prio;
+	g->period = period;
+	if (!strcmp(policy, "FIFO"))
+		g->policy = SCHED_FIFO;
+	else if (!strcmp(policy, "RR"))
+		g->policy = SCHED_RR;
+	else
+		return -1;
+	if (!strcmp(cpus, "all"))
+		cpumask_copy(&g->cpus, cpu_online_mask);
+	else if (cpulist_parse(cpus, &g->cpus))
+		return -1;
+	g->deadline = period;
+	if (strcmp(deadline, "-") &&
+	    (sscanf(deadline, "%llu", &g->deadline) != 1 || !g->deadline))
+		return -1;
+
+	line += len;
+	g->exec = linsched_parse_distribution(&line, rand_state);
+	while (g->exec && isspace(*line))
+		line++;
+	if (g->exec && *line)
+		g->sporadic = linsched_parse_distribution(&line, rand_state);
+	if (!g->exec || (*line && !g->sporadic))
+		return -1;
+	rt->n_tasks += n;
+	return 0;
+}
+
+static void rt_throttling(int cpu, int *nr, u64 *time)
+{
+	struct rt_rq *rt_rq = &cpu_rq(cpu)->rt;
+
+	*nr = rt_rq->rt_nr_throttled;
+	*time = rt_rq->rt_throttled_time;
+	if (rt_rq->rt_throttled)
+		*time += rt_rq->rq->clock - rt_rq->rt_throttled_timestamp;
+}
+
+/* Creates the tasks described by a file of lines
+ *   RT <name> <n> FIFO|RR <prio> <cpu list|all> <period> <deadline|->
+ *      <exec dist> [<sporadic dist>]
+ * (on one line) where the period and the relative deadline are in ns,
+ * a deadline of "-" is the period, and the distributions are in ns,
+ * as in linsched_create_sim(). The n tasks of a line may run on the
+ * cpus of the line that are also in cpus, and are all first released
+ * when the file is loaded. Empty lines and lines starting with '#'
+ * are ignored. */
+struct linsched_rt *linsched_load_rt(char *filename,
+				     const struct cpumask *cpus,
+				     unsigned int *rand_state)
+{
+	struct linsched_rt *rt = calloc(1, sizeof(*rt));
+	char line[256];
+	FILE *f;
+	int i, j, k = 0, lineno = 0, cpu;
+
+	BUG_ON(!rt);
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_rt_line(rt, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad rt line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!rt->n_groups) {
+		fprintf(stderr, "%s: no RT lines\n", filename);
+		goto err;
+	}
+	for (i = 0; i < rt->n_groups; i++) {
+		cpumask_and(&rt->groups[i]->cpus, &rt->groups[i]->cpus, cpus);
+		if (cpumask_empty(&rt->groups[i]->cpus)) {
+			fprintf(stderr, "%s: no cpus for %s\n", filename,
+				rt->groups[i]->name);
+			goto err;
+		}
+	}
+
+	rt->start = current_time;
+	for_each_online_cpu(cpu)
+		rt_throttling(cpu, &rt->nr_throttled[cpu],
+			      &rt->throttled_time[cpu]);
+
+	rt->tasks = calloc(rt->n_tasks, sizeof(struct task_struct *));
+	BUG_ON(!rt->tasks);
+	for (i = 0; i < rt->n_groups; i++) {
+		struct rt_group *g = rt->groups[i];
+
+		for (j = 0; j < g->n_tasks; j++, k++) {
+			struct task_data *td = malloc(sizeof(struct task_data));
+			struct rt_task *t = calloc(1, sizeof(*t));
+			struct task_struct *p;
+
+			BUG_ON(!td || !t);
+			t->g = g;
+			t->release = current_time;
+			t->exec = gen_ns(g->exec);
+			sleep_run_init(&t->sr_data);
+			td->data = t;
+			td->init_task = rt_task_start;
+			td->handle_task = rt_task_handle;
+			if (g->policy == SCHED_FIFO)
+				p = linsched_create_RTfifo_task(td, g->prio);
+			else
+				p = linsched_create_RTrr_task(td, g->prio);
+			set_cpus_allowed_ptr(p, &g->cpus);
+			t->migrations = p->se.nr_migrations;
+			rt->tasks[k] = p;
+		}
+	}
+	return rt;
+
+err:
+	linsched_destroy_rt(rt);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(struct rt_task *t, double pct)
+{
+	u64 n = t->n_resp;
+
+	if (!n)
+		return 0;
+	return t->resp[min((u64)(n * pct / 100), n - 1)] / 1000.0;
+}
+
+void linsched_print_rt_report(struct linsched_rt *rt)
+{
+	u64 elapsed = current_time - rt->start;
+	int i, cpu;
+
+	fprintf(stdout, "------ rt\n");
+	fprintf(stdout, "%-16s %4s %4s %8s %7s %6s %9s %9s %9s %9s %9s "
+		"%9s %6s\n", "task", "pol", "prio", "jobs", "misses", "miss%",
+		"resp_p50", "resp_p99", "resp_max", "jitter", "start_avg",
+		"start_max", "migr");
+	for (i = 0; i < rt->n_tasks; i++) {
+		struct task_struct *p = rt->tasks[i];
+		struct rt_task *t = task_thread_info(p)->td->data;
+		char name[40];
+
+		qsort(t->resp, t->n_resp, sizeof(u64), u64_compare);
+		snprintf(name, sizeof(name), "%s/%d", t->g->name,
+			 task_thread_info(p)->id);
+		fprintf(stdout, "%-16s %4s %4d %8llu %7llu %6.2f %9.1f %9.1f "
+			"%9.1f %9.1f %9.1f %9.1f %6llu\n", name,
+			t->g->policy == SCHED_FIFO ? "FIFO" : "RR", t->g->prio,
+			t->jobs, t->misses,
+			t->jobs ? 100.0 * t->misses / t->jobs : 0,
+			percentile_us(t, 50), percentile_us(t, 99),
+			percentile_us(t, 100),
+			percentile_us(t, 100) - percentile_us(t, 0),
+			t->jobs ? t->start_sum / 1000.0 / t->jobs : 0,
+			t->start_max / 1000.0,
+			p->se.nr_migrations - t->migrations);
+	}
+
+	fprintf(stdout, "%4s %10s %13s %10s\n", "cpu", "throttled",
+		"throttled_ms", "throttled%");
+	for_each_online_cpu(cpu) {
+		u64 time;
+		int nr;
+
+		rt_throttling(cpu, &nr, &time);
+		nr -= rt->nr_throttled[cpu];
+		time -= rt->throttled_time[cpu];
+		fprintf(stdout, "%4d %10d %13.1f %10.1f\n", cpu, nr,
+			time / 1e6, elapsed ? 100.0 * time / elapsed : 0);
+	}
+}
+
+void linsched_destroy_rt(struct linsched_rt *rt)
+{
+	int i;
+
+	if (!rt)
+		return;
+
+	for (i = 0; rt->tasks && i < rt->n_tasks; i++) {
+		struct thread_info *ti = task_thread_info(rt->tasks[i]);
+		struct rt_task *t = ti->td->data;
+
+		hrtimer_cancel(&t->sr_data.timer);
+		free(t->resp);
+		free(t);
+		free(ti->td);
+		ti->td = NULL;
+	}
+	for (i = 0; i < rt->n_groups; i++) {
+		if (rt->groups[i]->exec)
+			linsched_destroy_dist(rt->groups[i]->exec);
+		if (rt->groups[i]->sporadic)
+			linsched_destroy_dist(rt->groups[i]->sporadic);
+		free(rt->groups[i]);
+	}
+	free(rt->tasks);
+	free(rt);
+}
@@ -0,0 +1,69 @@
+/* Periodic real-time tasks for linsched
+ *
+ * Models control loops: SCHED_FIFO or SCHED_RR tasks that are released
+ * every period, as with clock_nanosleep(TIMER_ABSTIME), run a job of
+ * an execution time drawn from a distribution, and must finish it
+ * within a relative deadline. A sporadic task adds a random delay to
+ * the period, which is then its minimum interarrival time. A job that
+ * overruns into the next period delays the next job rather than
+ * dropping it, as a loop that sleeps until an absolute time would.
+ *
+ * The tasks are ordinary RT tasks in the root group, so they are
+ * moved by the push / pull of kernel/sched/rt.c like any other and
+ * throttled by the RT runtime of the root group. That runtime cannot
+ * exceed sysctl_sched_rt_runtime, so to throttle harder lower it
+ * first, e.g. with the "rt_runtime / <us>" scenario action (see
+ * linsched_load_scenario()). The report gives, per task, the
+ * deadline misses, the percentiles of the response time (release to
+ * completion), its jitter (largest minus smallest response), the
+ * release to start latency and the number of migrations, and the RT
+ * throttling of the cpus during the run.
+ */
+
+#ifndef __LINSCHED_RT_H
+#define __LINSCHED_RT_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define RT_MAX_GROUPS 32
+
+/* tasks with the same parameters */
+struct rt_group {
+	char name[32];
+	int policy, prio, n_tasks;
+	cpumask_t cpus;
+	u64 period, deadline;		/* ns */
+	struct rand_dist *exec;		/* ns of cpu time per job */
+	struct rand_dist *sporadic;	/* ns added to the period, or NULL */
+};
+
+struct rt_task {
+	struct sleep_run_data sr_data;
+	struct rt_group *g;
+	int started;			/* the current job has run */
+	u64 release, exec;		/* of the current job */
+	u64 migrations;		/* se.nr_migrations at the start */
+
+	/* stats */
+	u64 jobs, misses;
+	u64 start_sum, start_max;	/* release to first run, ns */
+	u64 *resp, n_resp, max_resp;	/* response times, ns */
+};
+
+struct linsched_rt {
+	int n_groups, n_tasks;
+	struct rt_group *groups[RT_MAX_GROUPS];
+	struct task_struct **tasks;
+	u64 start;
+	int nr_throttled[NR_CPUS];
+	u64 throttled_time[NR_CPUS];
+};
+
+struct linsched_rt *linsched_load_rt(char *filename,
+				     const struct cpumask *cpus,
+				     unsigned int *rand_state);
+void linsched_print_rt_report(struct linsched_rt *rt);
+void linsched_destroy_rt(struct linsched_rt *rt);
+
+#endif	/* __LINSCHED_RT_H */
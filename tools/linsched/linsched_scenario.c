@@ -0,0 +1,574 @@
+/* Timed scenarios for linsched, see linsched_scenario.h */
+
+#include "linsched.h"
+#include "linsched_scenario.h"
+#include "load_balance_score.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <assert.h>
+#include <ctype.h>
+
+extern int num_tasks, num_cgroups; /* defined in linux_linsched.c */
+
+/* only one scenario can be running, as linsched_run_sim() calls
+ * linsched_scenario_process() without arguments */
+static struct linsched_scenario *active_scenario;
+
+static const struct {
+	char *name;
+	enum scenario_action_type type;
+} action_types[] = { { "shares", SCN_SHARES },
+		     { "nice", SCN_NICE },
+		     { "affinity", SCN_AFFINITY },
+		     { "policy", SCN_POLICY },
+		     { "offline", SCN_OFFLINE },
+		     { "online", SCN_ONLINE },
+		     { "create", SCN_CREATE },
+		     { "mkdir", SCN_MKDIR },
+		     { "move", SCN_MOVE },
+		     { "partition", SCN_PARTITION },
+		     { "bandwidth", SCN_BANDWIDTH },
+		     { "rt_runtime", SCN_RT_RUNTIME },
+		     { "setsid", SCN_SETSID },
+		     { "exit", SCN_EXIT } };
+
+static const struct {
+	char *name;
+	int policy;
+} policies[] = { { "normal", SCHED_NORMAL },
+		 { "batch", SCHED_BATCH },
+		 { "idle", SCHED_IDLE },
+		 { "fifo", SCHED_FIFO },
+		 { "rr", SCHED_RR } };
+
+struct linsched_scenario *linsched_create_scenario(void)
+{
+	struct linsched_scenario *scn = calloc(1, sizeof(*scn));
+
+	assert(scn);
+	scn->recovery_pct = SCENARIO_RECOVERY_PCT;
+	scn->recovery_ticks = SCENARIO_RECOVERY_TICKS;
+	return scn;
+}
+
+/* returns the next whitespace separated word of *line_ptr in word, or
+ * 0 at the end of the line */
+static int next_word(char **line_ptr, char *word, size_t size)
+{
+	int len;
+	char fmt[16];
+
+	snprintf(fmt, sizeof(fmt), " %%%zus%%n", size - 1);
+	if (sscanf(*line_ptr, fmt, word, &len) < 1)
+		return 0;
+	*line_ptr += len;
+	return 1;
+}
+
+static int next_long(char **line_ptr, long *val)
+{
+	char word[32], *end;
+
+	if (!next_word(line_ptr, word, sizeof(word)))
+		return 0;
+	*val = simple_strtol(word, &end, 0);
+	return !*end;
+}
+
+static int parse_policy(char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(policies); i++)
+		if (!strcmp(name, policies[i].name))
+			return policies[i].policy;
+	return -1;
+}
+
+static int parse_masks(char **line_ptr, struct scenario_action *act)
+{
+	char word[64];
+
+	while (next_word(line_ptr, word, sizeof(word))) {
+		act->masks = realloc(act->masks, (act->n_masks + 1) *
+				     sizeof(struct cpumask));
+		assert(act->masks);
+		if (cpulist_parse(word, &act->masks[act->n_masks]))
+			return 0;
+		act->n_masks++;
+	}
+	return act->n_masks > 0;
+}
+
+/* parses the arguments of act->type from line, returns true if
+ * successful. The formats are:
+ *   shares <cgroup> <shares>
+ *   nice <target> <nice>
+ *   affinity <target> <cpulist>
+ *   policy <target> normal|batch|idle|fifo|rr [<rt priority>]
+ *   offline <cpu>
+ *   online <cpu>
+ *   create <n> <sleep ms> <busy ms> [<cgroup> [<nice>]]
+ *   mkdir <cgroup> [<shares>]
+ *   move <target> <cgroup>
+ *   partition <cpulist> [<cpulist> ...]
+ *   bandwidth <cgroup> <quota us> [<period us>]
+ *   rt_runtime <cgroup> <runtime us> [<period us>]
+ *   setsid <target>
+ *   exit <target>
+ * where a target is a task id, a cgroup path (all of its tasks) or
+ * "all". Missing cgroups are created with default shares. Only the
+ * tasks made by create actions can exit, as the other tasks belong to
+ * the simulation that made them. */
+static int parse_action_args(char *line, struct scenario_action *act)
+{
+	char word[64];
+	long *args = act->args;
+
+	switch (act->type) {
+	case SCN_SHARES:
+		return next_word(&line, act->target, sizeof(act->target)) &&
+			next_long(&line, &args[0]) && act->target[0] == '/';
+	case SCN_NICE:
+		return next_word(&line, act->target, sizeof(act->target)) &&
+			next_long(&line, &args[0]);
+	case SCN_AFFINITY:
+		return next_word(&line, act->target, sizeof(act->target)) &&
+			parse_masks(&line, act) && act->n_masks == 1;
+	case SCN_POLICY:
+		if (!next_word(&line, act->target, sizeof(act->target)) ||
+		    !next_word(&line, word, sizeof(word)))
+			return 0;
+		args[0] = parse_policy(word);
+		next_long(&line, &args[1]);
+		return args[0] >= 0;
+	case SCN_OFFLINE:
+	case SCN_ONLINE:
+		return next_long(&line, &args[0]) && args[0] >= 0 &&
+			args[0] < nr_cpu_ids;
+	case SCN_CREATE:
+		if (!next_long(&line, &args[0]) || !next_long(&line, &args[1]) ||
+		    !next_long(&line, &args[2]))
+			return 0;
+		if (next_word(&line, act->path, sizeof(act->path)))
+			next_long(&line, &args[3]);
+		return args[0] > 0;
+	case SCN_MKDIR:
+		if (!next_word(&line, act->target, sizeof(act->target)))
+			return 0;
+		next_long(&line, &args[0]);
+		return act->target[0] == '/';
+	case SCN_MOVE:
+		return next_word(&line, act->target, sizeof(act->target)) &&
+			next_word(&line, act->path, sizeof(act->path)) &&
+			act->path[0] == '/';
+	case SCN_PARTITION:
+		return parse_masks(&line, act);
+	case SCN_BANDWIDTH:
+	case SCN_RT_RUNTIME:
+		if (!next_word(&line, act->target, sizeof(act->target)) ||
+		    !next_long(&line, &args[0]))
+			return 0;
+		next_long(&line, &args[1]);
+		return act->target[0] == '/';
+	case SCN_SETSID:
+	case SCN_EXIT:
+		return next_word(&line, act->target, sizeof(act->target));
+	}
+	return 0;
+}
+
+/* parses "<time ms> <action> <args>" and adds it to the scenario,
+ * keeping actions at the same time in the order they were added.
+ * Returns 0 if successful. */
+int linsched_add_scenario_action(struct linsched_scenario *scn, char *line)
+{
+	struct scenario_action act = {};
+	char name[32];
+	double ms;
+	int i, len;
+
+	if (sscanf(line, "%lf%n", &ms, &len) < 1 || ms < 0)
+		return -EINVAL;
+	line += len;
+	if (!next_word(&line, name, sizeof(name)))
+		return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(action_types); i++)
+		if (!strcmp(name, action_types[i].name))
+			break;
+	if (i == ARRAY_SIZE(action_types))
+		return -EINVAL;
+
+	act.type = action_types[i].type;
+	act.time = ms * NSEC_PER_MSEC;
+	if (!parse_action_args(line, &act)) {
+		free(act.masks);
+		return -EINVAL;
+	}
+	snprintf(act.text, sizeof(act.text), "%s%s", name, line);
+	len = strlen(act.text);
+	while (len && isspace(act.text[len - 1]))
+		act.text[--len] = '\0';
+
+	scn->actions = realloc(scn->actions, (scn->n_actions + 1) *
+			       sizeof(struct scenario_action));
+	assert(scn->actions);
+	for (i = scn->n_actions; i > 0 && scn->actions[i - 1].time > act.time;
+	     i--)
+		scn->actions[i] = scn->actions[i - 1];
+	scn->actions[i] = act;
+	scn->n_actions++;
+	return 0;
+}
+
+/* loads a scenario file of "<time ms> <action> <args>" lines, see
+ * parse_action_args() for the actions. Blank lines and lines starting
+ * with # are ignored. */
+struct linsched_scenario *linsched_load_scenario(char *filename)
+{
+	struct linsched_scenario *scn;
+	char line[256];
+	int lineno = 0;
+	FILE *f = fopen(filename, "r");
+
+	if (!f)
+		return NULL;
+
+	scn = linsched_create_scenario();
+	while (fgets(line, sizeof(line), f)) {
+		char *s = line;
+
+		lineno++;
+		while (isspace(*s))
+			s++;
+		if (!*s || *s == '#')
+			continue;
+		if (linsched_add_scenario_action(scn, s)) {
+			fprintf(stderr, "%s:%d: bad scenario action: %s",
+				filename, lineno, line);
+			linsched_destroy_scenario(scn);
+			fclose(f);
+			return NULL;
+		}
+	}
+	fclose(f);
+	return scn;
+}
+
+/* returns the cgroup at path, creating it and its missing ancestors
+ * with default shares if create is set */
+struct cgroup *linsched_find_cgroup(const char *path, int create)
+{
+	char buf[128], parent_path[128];
+	const char *name;
+	struct cgroup *parent;
+	int i;
+
+	if (!strcmp(path, "/"))
+		return root_cgroup;
+	for (i = 0; i < num_cgroups; i++) {
+		struct cgroup *cg = &__linsched_cgroups[i].cg;
+
+		if (!cgroup_path(cg, buf, sizeof(buf)) && !strcmp(buf, path))
+			return cg;
+	}
+	if (!create)
+		return NULL;
+
+	name = strrchr(path, '/');
+	snprintf(parent_path, sizeof(parent_path), "%.*s",
+		 name == path ? 1 : (int)(name - path), path);
+	parent = linsched_find_cgroup(parent_path, 1);
+	return linsched_create_cgroup(parent, (char *)name + 1);
+}
+
+static int task_matches(struct task_struct *p, const char *target,
+			struct task_group *tg)
+{
+	if (tg)
+		return task_group(p) == tg;
+	return !strcmp(target, "all") ||
+		simple_strtoul(target, NULL, 0) == task_thread_info(p)->id;
+}
+
+#define for_each_target_task(p, i, target, tg)				\
+	for (i = 1; i < num_tasks; i++)					\
+		if ((p = linsched_get_task(i)) &&			\
+		    task_matches(p, target, tg))
+
+static struct task_group *target_group(const char *target)
+{
+	struct cgroup *cg;
+
+	if (target[0] != '/')
+		return NULL;
+	cg = linsched_find_cgroup(target, 1);
+	return cgroup_tg(cg);
+}
+
+/* replaces the handler of a task made by a create action, to end it
+ * the next time it runs */
+static void scenario_exit_handle(struct task_struct *p, void *data)
+{
+	struct task_data *td = task_thread_info(p)->td;
+	struct sleep_run_task *d = data;
+
+	hrtimer_cancel(&d->sr_data.timer);
+	linsched_exit_task(p);
+	free(d);
+	free(td);
+}
+
+static void fire_action(struct linsched_scenario *scn,
+			struct scenario_action *act)
+{
+	struct task_group *tg = target_group(act->target);
+	struct sched_param param = {};
+	struct task_struct *p;
+	cpumask_var_t *doms;
+	long *args = act->args;
+	int i;
+
+	switch (act->type) {
+	case SCN_SHARES:
+		sched_group_set_shares(tg, args[0]);
+		break;
+	case SCN_NICE:
+		for_each_target_task(p, i, act->target, tg)
+			set_user_nice(p, args[0]);
+		break;
+	case SCN_AFFINITY:
+		for_each_target_task(p, i, act->target, tg)
+			set_cpus_allowed_ptr(p, &act->masks[0]);
+		break;
+	case SCN_POLICY:
+		param.sched_priority = args[1];
+		for_each_target_task(p, i, act->target, tg)
+			if (sched_setscheduler(p, args[0], &param))
+				fprintf(stderr, "scenario: %s failed for "
+					"task %d\n", act->text, i);
+		break;
+	case SCN_OFFLINE:
+		if (cpu_online(args[0]))
+			linsched_offline_cpu(args[0]);
+		break;
+	case SCN_ONLINE:
+		if (!cpu_online(args[0]))
+			linsched_online_cpu(args[0]);
+		break;
+	case SCN_CREATE:
+		for (i = 0; i < args[0]; i++) {
+			struct task_data *td =
+				linsched_create_sleep_run(args[1], args[2]);
+
+			p = linsched_create_normal_task(td, args[3]);
+			scn->created = realloc(scn->created,
+					       (scn->n_created + 1) *
+					       sizeof(struct task_struct *));
+			assert(scn->created);
+			scn->created[scn->n_created++] = p;
+			if (act->path[0])
+				linsched_add_task_to_group(p,
+					linsched_find_cgroup(act->path, 1));
+		}
+		break;
+	case SCN_MKDIR:
+		if (args[0])
+			sched_group_set_shares(tg, args[0]);
+		break;
+	case SCN_MOVE:
+		for_each_target_task(p, i, act->target, tg)
+			linsched_add_task_to_group(p,
+				linsched_find_cgroup(act->path, 1));
+		break;
+	case SCN_PARTITION:
+		doms = alloc_sched_domains(act->n_masks);
+		for (i = 0; i < act->n_masks; i++)
+			cpumask_copy(doms[i], &act->masks[i]);
+		/* the domains are freed by the scheduler */
+		partition_sched_domains(act->n_masks, doms, NULL);
+		break;
+	case SCN_BANDWIDTH:
+		if (linsched_set_task_group_bandwidth(tg->css.cgroup, args[1],
+						      args[0]))
+			fprintf(stderr, "scenario: invalid bandwidth: %s\n",
+				act->text);
+		break;
+	case SCN_RT_RUNTIME:
+		if (linsched_set_task_group_rt_runtime(tg->css.cgroup, args[1],
+						       args[0]))
+			fprintf(stderr, "scenario: invalid rt runtime: %s\n",
+				act->text);
+		break;
+	case SCN_SETSID:
+		for_each_target_task(p, i, act->target, tg)
+			linsched_create_autogroup(p);
+		break;
+	case SCN_EXIT:
+		for (i = 0; i < scn->n_created; i++) {
+			p = scn->created[i];
+			if (!task_matches(p, act->target, tg))
+				continue;
+			task_thread_info(p)->td->handle_task =
+				scenario_exit_handle;
+			/* its id may be reused once it has exited */
+			scn->created[i--] = scn->created[--scn->n_created];
+		}
+		break;
+	}
+}
+
+static enum hrtimer_restart scenario_timer(struct hrtimer *timer)
+{
+	struct linsched_scenario *scn =
+		container_of(timer, struct linsched_scenario, timer);
+
+	/* actions may sleep or hotplug cpus, so they are run from
+	 * linsched_scenario_process() rather than in irq context */
+	scn->pending = 1;
+	return HRTIMER_NORESTART;
+}
+
+/* arm the timer for the next action on the first online cpu, which
+ * is the least likely to be unplugged under us */
+static void arm_next_action(struct linsched_scenario *scn)
+{
+	int old_cpu = smp_processor_id();
+	u64 when, delta = 1;
+
+	if (scn->next >= scn->n_actions)
+		return;
+
+	when = scn->start + scn->actions[scn->next].time;
+	if (when > current_time)
+		delta = when - current_time;
+
+	linsched_change_cpu(cpumask_first(cpu_online_mask));
+	hrtimer_start(&scn->timer, ns_to_ktime(delta), HRTIMER_MODE_REL);
+	linsched_change_cpu(old_cpu);
+}
+
+/* starts the scenario clock; call before linsched_run_sim() */
+void linsched_start_scenario(struct linsched_scenario *scn)
+{
+	BUG_ON(active_scenario);
+	active_scenario = scn;
+
+	scn->next = 0;
+	scn->pending = 0;
+	scn->start = scn->window_start = scn->last_update = current_time;
+	scn->window_imbalance = 0;
+	hrtimer_init(&scn->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	scn->timer.function = scenario_timer;
+	arm_next_action(scn);
+}
+
+static void track_recovery(struct linsched_scenario *scn)
+{
+	double imbalance = get_current_imbalance();
+	u64 hold = (u64)scn->recovery_ticks * TICK_NSEC;
+	int i;
+
+	scn->window_imbalance += imbalance *
+		(current_time - scn->last_update);
+	scn->last_update = current_time;
+
+	for (i = 0; i < scn->next; i++) {
+		struct scenario_action *act = &scn->actions[i];
+
+		if (!act->settling || current_time == act->fired)
+			continue;
+		act->peak_imbalance = max(act->peak_imbalance, imbalance);
+		if (imbalance > act->prior_imbalance *
+		    (100 + scn->recovery_pct) / 100) {
+			act->within = 0;
+			continue;
+		}
+		if (!act->within)
+			act->within = current_time;
+		if (current_time - act->within >= hold) {
+			act->recovered = act->within;
+			act->settling = 0;
+		}
+	}
+}
+
+/* called from linsched_run_sim() after each event: fires the actions
+ * that are due and tracks how the imbalance recovers from them */
+void linsched_scenario_process(void)
+{
+	struct linsched_scenario *scn = active_scenario;
+	u64 window;
+
+	if (!scn)
+		return;
+
+	track_recovery(scn);
+	if (!scn->pending)
+		return;
+
+	scn->pending = 0;
+	window = current_time - scn->window_start;
+	while (scn->next < scn->n_actions &&
+	       scn->start + scn->actions[scn->next].time <= current_time) {
+		struct scenario_action *act = &scn->actions[scn->next++];
+
+		act->fired = current_time;
+		act->prior_imbalance = window ?
+			scn->window_imbalance / window : 0;
+		act->peak_imbalance = get_current_imbalance();
+		act->within = 0;
+		act->settling = 1;
+		fire_action(scn, act);
+		linsched_check_resched();
+	}
+	scn->window_imbalance = 0;
+	scn->window_start = current_time;
+	arm_next_action(scn);
+}
+
+void linsched_print_scenario_report(struct linsched_scenario *scn)
+{
+	int i;
+
+	fprintf(stdout, "------ scenario\n");
+	fprintf(stdout, "recovered: back within %d%% of the prior imbalance "
+		"for %d ticks\n", scn->recovery_pct, scn->recovery_ticks);
+	for (i = 0; i < scn->n_actions; i++) {
+		struct scenario_action *act = &scn->actions[i];
+		double at = (double)act->time / NSEC_PER_MSEC;
+
+		if (i >= scn->next) {
+			fprintf(stdout, "%.3f ms %s: not reached\n", at,
+				act->text);
+			continue;
+		}
+		fprintf(stdout, "%.3f ms %s: ", at, act->text);
+		if (act->settling)
+			fprintf(stdout, "not recovered");
+		else
+			fprintf(stdout, "recovered in %.3f ms",
+				(double)(act->recovered - act->fired) /
+				NSEC_PER_MSEC);
+		fprintf(stdout, ", prior imbalance = %f, peak imbalance = %f\n",
+			act->prior_imbalance, act->peak_imbalance);
+	}
+	fprintf(stdout, "\n");
+}
+
+void linsched_destroy_scenario(struct linsched_scenario *scn)
+{
+	int i;
+
+	if (!scn)
+		return;
+	if (active_scenario == scn) {
+		hrtimer_cancel(&scn->timer);
+		active_scenario = NULL;
+	}
+	for (i = 0; i < scn->n_actions; i++)
+		free(scn->actions[i].masks);
+	free(scn->actions);
+	free(scn->created);
+	free(scn);
+}
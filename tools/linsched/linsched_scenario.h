@@ -0,0 +1,85 @@
+/* Timed scenarios for linsched
+ *
+ * A scenario is a timeline of state changes (shares, bandwidth, RT
+ * runtime, nice, affinity, policy, hotplug, cgroup, autogroup and sched
+ * domain changes, new and exiting tasks) that are applied at exact
+ * simulated times while linsched_run_sim() runs.
+ * After each action the load imbalance is tracked until it is back
+ * within recovery_pct of its average since the previous action, and
+ * stays there for recovery_ticks ticks, to measure how quickly balance
+ * recovers.
+ */
+
+#ifndef __LINSCHED_SCENARIO_H
+#define __LINSCHED_SCENARIO_H
+
+#include "linsched.h"
+
+#define SCENARIO_MAX_ARGS 4
+#define SCENARIO_RECOVERY_PCT 10
+#define SCENARIO_RECOVERY_TICKS 10
+
+enum scenario_action_type {
+	SCN_SHARES,
+	SCN_NICE,
+	SCN_AFFINITY,
+	SCN_POLICY,
+	SCN_OFFLINE,
+	SCN_ONLINE,
+	SCN_CREATE,
+	SCN_MKDIR,
+	SCN_MOVE,
+	SCN_PARTITION,
+	SCN_BANDWIDTH,
+	SCN_RT_RUNTIME,
+	SCN_SETSID,
+	SCN_EXIT,
+};
+
+struct scenario_action {
+	u64 time;		/* ns after the start of the scenario */
+	enum scenario_action_type type;
+	char target[64];	/* task id, cgroup path or "all" */
+	char path[64];		/* cgroup argument of create / move */
+	long args[SCENARIO_MAX_ARGS];
+	struct cpumask *masks;	/* affinity, or one per partition */
+	int n_masks;
+	char text[128];		/* the action as given, for the report */
+
+	/* recovery tracking */
+	u64 fired;
+	u64 recovered;
+	double prior_imbalance;
+	double peak_imbalance;
+	u64 within;		/* since when it has been near the prior */
+	int settling;
+};
+
+struct linsched_scenario {
+	int n_actions;
+	struct scenario_action *actions;	/* sorted by time */
+	int next;
+	u64 start;
+	int pending;
+	struct hrtimer timer;
+	int recovery_pct, recovery_ticks;
+
+	/* the tasks of create actions that have not been told to exit */
+	struct task_struct **created;
+	int n_created;
+
+	/* time weighted imbalance since the last action fired */
+	double window_imbalance;
+	u64 window_start;
+	u64 last_update;
+};
+
+struct linsched_scenario *linsched_create_scenario(void);
+struct linsched_scenario *linsched_load_scenario(char *filename);
+int linsched_add_scenario_action(struct linsched_scenario *scn, char *line);
+void linsched_start_scenario(struct linsched_scenario *scn);
+void linsched_scenario_process(void);
+void linsched_print_scenario_report(struct linsched_scenario *scn);
+void linsched_destroy_scenario(struct linsched_scenario *scn);
+
+#endif	/* __LINSCHED_SCENARIO_H */
@@ -0,0 +1,397 @@
+/* Open loop request serving for linsched, see linsched_server.h */
+
+#include "linsched.h"
+#include "linsched_server.h"
+#include "linsched_sim.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <ctype.h>
+
+/* stdlib.h conflicts with linux/sched.h unfortunately */
+void qsort(void *base, size_t nmemb, size_t size,
+	   int(*compar)(const void *, const void *));
+
+struct server_request {
+	struct list_head list;
+	u64 arrival;
+	u64 service;		/* ns */
+	int step;
+};
+
+struct server_worker {
+	struct sleep_run_data sr_data;
+	struct linsched_server *srv;
+	wait_queue_t wait;
+	int waiting;
+	struct server_request *req;	/* being served, NULL when idle */
+};
+
+static u64 gen_ns(struct rand_dist *rdist)
+{
+	double v = rdist->gen_fn(rdist);
+
+	return v > 0 ? v : 0;
+}
+
+static int step_of(struct linsched_server *srv, u64 t)
+{
+	if (!srv->step_len)
+		return 0;
+	return (t - srv->start) / srv->step_len;
+}
+
+static enum hrtimer_restart server_arrival(struct hrtimer *timer)
+{
+	struct linsched_server *srv =
+		container_of(timer, struct linsched_server, timer);
+	int step = step_of(srv, current_time);
+	struct server_request *req;
+	struct server_step *st;
+	u64 next;
+
+	/* the ramp is over */
+	if (step >= srv->n_steps)
+		return HRTIMER_NORESTART;
+
+	st = &srv->steps[step];
+	req = malloc(sizeof(*req));
+	BUG_ON(!req);
+	req->arrival = current_time;
+	req->service = gen_ns(srv->service);
+	req->step = step;
+	st->arrivals++;
+	st->demand += req->service;
+	list_add_tail(&req->list, &srv->queue);
+	srv->max_queued = max(srv->max_queued, ++srv->queued);
+	wake_up_interruptible(&srv->wq);
+
+	/* open loop: the next arrival does not wait for this one */
+	next = gen_ns(srv->arrival) / st->load;
+	hrtimer_add_expires_ns(timer, max(next, 1ULL));
+	return HRTIMER_RESTART;
+}
+
+static void server_complete(struct linsched_server *srv,
+			    struct server_request *req)
+{
+	struct server_step *st = &srv->steps[req->step];
+
+	if (st->completed == st->max_latencies) {
+		st->max_latencies = max(2 * st->max_latencies, 1024ULL);
+		st->latencies = realloc(st->latencies, st->max_latencies *
+					sizeof(u64));
+		BUG_ON(!st->latencies);
+	}
+	st->latencies[st->completed++] = current_time - req->arrival;
+	free(req);
+}
+
+static void server_worker_start(struct task_struct *p, void *data)
+{
+	struct server_worker *w = data;
+
+	sleep_run_start(p, &w->sr_data);
+	init_wait(&w->wait);
+	w->wait.private = p;
+}
+
+static void server_worker_handle(struct task_struct *p, void *data)
+{
+	struct server_worker *w = data;
+	struct linsched_server *srv = w->srv;
+
+	if (w->waiting) {
+		finish_wait(&srv->wq, &w->wait);
+		w->waiting = 0;
+	}
+
+	while (1) {
+		if (w->req) {
+			if (!sleep_run_run_for(&w->sr_data, w->req->service))
+				return;
+			server_complete(srv, w->req);
+			w->req = NULL;
+		}
+
+		if (list_empty(&srv->queue))
+			break;
+		w->req = list_first_entry(&srv->queue, struct server_request,
+					  list);
+		list_del(&w->req->list);
+		srv->queued--;
+	}
+
+	/* idle, block until a request arrives */
+	hrtimer_try_to_cancel(&w->sr_data.timer);
+	prepare_to_wait_exclusive(&srv->wq, &w->wait, TASK_INTERRUPTIBLE);
+	w->waiting = 1;
+	schedule();
+}
+
+static int parse_server_line(struct linsched_server *srv, char *line,
+			     unsigned int *rand_state)
+{
+	char path[128] = "";
+	double from, to;
+	long shares = 0;
+	int n, ms;
+
+	if (sscanf(line, "WORKERS %d %127s %ld", &n, path, &shares) >= 1) {
+		if (n <= 0 || (path[0] && path[0] != '/'))
+			return -1;
+		srv->n_workers = n;
+		srv->cg = path[0] ? linsched_find_cgroup(path, 1) :
+			root_cgroup;
+		if (shares && srv->cg != root_cgroup)
+			sched_group_set_shares(cgroup_tg(srv->cg), shares);
+	} else if (!strncmp(line, "ARRIVAL ", 8)) {
+		line += 8;
+		srv->arrival = linsched_parse_distribution(&line, rand_state);
+		return srv->arrival ? 0 : -1;
+	} else if (!strncmp(line, "SERVICE ", 8)) {
+		line += 8;
+		srv->service = linsched_parse_distribution(&line, rand_state);
+		return srv->service ? 0 : -1;
+	} else if (sscanf(line, "SLO %lf %d", &from, &n) == 2) {
+		if (from <= 0 || from > 100 || n <= 0)
+			return -1;
+		srv->slo_pct = from;
+		srv->slo = (u64)n * NSEC_PER_USEC;
+	} else if (sscanf(line, "RAMP %lf %lf %d %d", &from, &to, &n,
+			  &ms) == 4) {
+		if (from <= 0 || to <= 0 || n <= 0 || n > SERVER_MAX_STEPS ||
+		    ms <= 0)
+			return -1;
+		srv->n_steps = n;
+		srv->step_len = (u64)ms * NSEC_PER_MSEC;
+		for (n = 0; n < srv->n_steps; n++)
+			srv->steps[n].load = srv->n_steps == 1 ? from :
+				from + (to - from) * n / (srv->n_steps - 1);
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/* Creates the workers of a server described by a file of lines
+ *   WORKERS <n> [<cgroup> [<shares>]]
+ *   ARRIVAL <interarrival dist>
+ *   SERVICE <service time dist>
+ *   SLO <percentile> <us>
+ *   RAMP <from> <to> <steps> <ms per step>
+ * where distributions are in ns, as in linsched_create_sim(), and
+ * only WORKERS, ARRIVAL and SERVICE are required. RAMP multiplies the
+ * arrival rate by from, then by evenly spaced factors up to to, each
+ * for ms; arrivals stop after the last step. Without it the arrival
+ * rate is constant and the run is a single step. Empty lines and
+ * lines starting with '#' are ignored.
+ *
+ * Arrivals are timed on the first of cpus, like the interrupts of a
+ * single queue NIC. */
+struct linsched_server *linsched_load_server(char *filename,
+					     const struct cpumask *cpus,
+					     unsigned int *rand_state)
+{
+	struct linsched_server *srv = calloc(1, sizeof(*srv));
+	int old_cpu = smp_processor_id();
+	char line[256];
+	FILE *f;
+	int i, lineno = 0;
+
+	BUG_ON(!srv);
+	srv->n_steps = 1;
+	srv->steps[0].load = 1;
+	srv->slo_pct = 99;
+	init_waitqueue_head(&srv->wq);
+	INIT_LIST_HEAD(&srv->queue);
+
+	f = fopen(filename, "r");
+	if (!f)
+		goto err;
+	while (fgets(line, sizeof(line), f)) {
+		char *end = line + strlen(line);
+
+		lineno++;
+		/* distributions want a space after their last argument */
+		while (end > line && isspace(end[-1]))
+			end--;
+		if (end == line || line[0] == '#')
+			continue;
+		strcpy(end, " ");
+		if (parse_server_line(srv, line, rand_state)) {
+			fprintf(stderr, "%s:%d: bad server line: %s\n",
+				filename, lineno, line);
+			fclose(f);
+			goto err;
+		}
+	}
+	fclose(f);
+	if (!srv->n_workers || !srv->arrival || !srv->service) {
+		fprintf(stderr, "%s: a server needs WORKERS, ARRIVAL and "
+			"SERVICE\n", filename);
+		goto err;
+	}
+
+	srv->workers = calloc(srv->n_workers, sizeof(struct task_struct *));
+	BUG_ON(!srv->workers);
+	for (i = 0; i < srv->n_workers; i++) {
+		struct task_data *td = malloc(sizeof(struct task_data));
+		struct server_worker *w = calloc(1, sizeof(*w));
+
+		BUG_ON(!td || !w);
+		w->srv = srv;
+		sleep_run_init(&w->sr_data);
+		td->data = w;
+		td->init_task = server_worker_start;
+		td->handle_task = server_worker_handle;
+		srv->workers[i] = linsched_create_normal_task(td, 0);
+		set_cpus_allowed_ptr(srv->workers[i], cpus);
+		linsched_add_task_to_group(srv->workers[i], srv->cg);
+	}
+
+	srv->start = current_time;
+	hrtimer_init(&srv->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	srv->timer.function = server_arrival;
+	linsched_change_cpu(cpumask_first(cpus));
+	hrtimer_start(&srv->timer, ns_to_ktime(max(gen_ns(srv->arrival) /
+						   srv->steps[0].load, 1.0)),
+		      HRTIMER_MODE_REL);
+	linsched_change_cpu(old_cpu);
+	return srv;
+
+err:
+	linsched_destroy_server(srv);
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* the pct percentile response time of the requests that arrived in a
+ * step; unfinished requests count as infinitely slow, ULLONG_MAX */
+static u64 step_percentile(struct server_step *st, double pct)
+{
+	u64 rank;
+
+	if (!st->arrivals)
+		return 0;
+	rank = DIV_ROUND_UP((u64)(st->arrivals * pct * 1000), 100000);
+	rank = rank ? rank - 1 : 0;
+	if (rank >= st->completed)
+		return ULLONG_MAX;
+	return st->latencies[rank];
+}
+
+static void print_us(u64 ns)
+{
+	if (ns == ULLONG_MAX)
+		fprintf(stdout, " %10s", "-");
+	else
+		fprintf(stdout, " %10.1f", ns / 1000.0);
+}
+
+void linsched_print_server_report(struct linsched_server *srv)
+{
+	u64 elapsed = current_time - srv->start;
+	int i, broken = -1, held = -1, not_reached = 0;
+	char buf[128];
+
+	cgroup_path(srv->cg, buf, sizeof(buf));
+	fprintf(stdout, "------ server\n");
+	if (srv->step_len && srv->n_steps * srv->step_len > elapsed)
+		fprintf(stdout, "warning: the run (%llu ms) is shorter than "
+			"the ramp (%llu ms)\n", elapsed / NSEC_PER_MSEC,
+			srv->n_steps * srv->step_len / NSEC_PER_MSEC);
+	fprintf(stdout, "workers = %d, cgroup = %s, max queued = %d",
+		srv->n_workers, buf, srv->max_queued);
+	if (srv->slo)
+		fprintf(stdout, ", SLO: p%g <= %llu us", srv->slo_pct,
+			srv->slo / NSEC_PER_USEC);
+	fprintf(stdout, "\n%4s %6s %9s %10s %6s %10s %10s %10s %10s %10s "
+		"%10s %s\n", "step", "load", "arrivals", "req/s", "cpus",
+		"p50_us", "p90_us", "p99_us", "p99.9_us", "max_us",
+		"unfinished", srv->slo ? "slo" : "");
+
+	for (i = 0; i < srv->n_steps; i++) {
+		struct server_step *st = &srv->steps[i];
+		u64 len = srv->step_len ? srv->step_len : elapsed;
+		int ok;
+
+		/* steps the run did not get to, or too little of to see a
+		 * request, say nothing about the SLO */
+		if (i * len >= elapsed || !st->arrivals) {
+			fprintf(stdout, "%4d %6.2f %9llu not reached\n", i,
+				st->load, st->arrivals);
+			not_reached++;
+			continue;
+		}
+		len = min(len, elapsed - i * len);
+
+		qsort(st->latencies, st->completed, sizeof(u64), u64_compare);
+		ok = step_percentile(st, srv->slo_pct) <= srv->slo;
+		fprintf(stdout, "%4d %6.2f %9llu %10.1f %6.2f", i, st->load,
+			st->arrivals, st->arrivals * (double)NSEC_PER_SEC / len,
+			st->demand / (double)len);
+		print_us(step_percentile(st, 50));
+		print_us(step_percentile(st, 90));
+		print_us(step_percentile(st, 99));
+		print_us(step_percentile(st, 99.9));
+		print_us(step_percentile(st, 100));
+		fprintf(stdout, " %10llu %s\n", st->arrivals - st->completed,
+			!srv->slo ? "" : ok ? "ok" : "BROKEN");
+
+		if (!ok && broken < 0)
+			broken = i;
+		if (ok && broken < 0)
+			held = i;
+	}
+
+	if (!srv->slo)
+		return;
+	if (held >= 0)
+		fprintf(stdout, "SLO holds up to load %.2f\n",
+			srv->steps[held].load);
+	if (broken >= 0)
+		fprintf(stdout, "SLO breaks at load %.2f\n",
+			srv->steps[broken].load);
+	else if (not_reached)
+		fprintf(stdout, "SLO never breaks in the steps reached\n");
+	else
+		fprintf(stdout, "SLO never breaks\n");
+}
+
+void linsched_destroy_server(struct linsched_server *srv)
+{
+	struct server_request *req, *tmp;
+	int i;
+
+	if (!srv)
+		return;
+
+	if (srv->timer.function)
+		hrtimer_cancel(&srv->timer);
+	for (i = 0; srv->workers && i < srv->n_workers; i++) {
+		struct thread_info *ti = task_thread_info(srv->workers[i]);
+		struct server_worker *w = ti->td->data;
+
+		hrtimer_cancel(&w->sr_data.timer);
+		free(w->req);
+		free(w);
+		free(ti->td);
+		ti->td = NULL;
+	}
+	list_for_each_entry_safe(req, tmp, &srv->queue, list)
+		free(req);
+	for (i = 0; i < srv->n_steps; i++)
+		free(srv->steps[i].latencies);
+	if (srv->arrival)
+		linsched_destroy_dist(srv->arrival);
+	if (srv->service)
+		linsched_destroy_dist(srv->service);
+	free(srv->workers);
+	free(srv);
+}
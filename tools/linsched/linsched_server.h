@@ -0,0 +1,58 @@
+/* Open loop request serving for linsched
+ *
+ * Models a server: requests arrive from an hrtimer at intervals drawn
+ * from a distribution (EXPONENTIAL for a Poisson process, or
+ * EMPIRICAL), independent of how fast they are served, and are queued
+ * for a pool of worker tasks in a cgroup. A worker blocks on the wait
+ * queue of the request queue and, once woken, runs for the service
+ * time of the request.
+ *
+ * The arrival rate can be ramped up in steps, and the report gives the
+ * response time percentiles of the requests that arrived in each step,
+ * and the load at which the response time percentile of the SLO first
+ * exceeds its bound.
+ */
+
+#ifndef __LINSCHED_SERVER_H
+#define __LINSCHED_SERVER_H
+
+#include "linsched.h"
+#include "linsched_rand.h"
+
+#define SERVER_MAX_STEPS 64
+
+struct server_step {
+	double load;		/* multiplier of the arrival rate */
+	u64 arrivals, completed;
+	u64 demand;		/* ns of service of the arrivals */
+	u64 *latencies;		/* response times, ns */
+	u64 max_latencies;
+};
+
+struct linsched_server {
+	int n_workers;
+	struct task_struct **workers;
+	struct cgroup *cg;
+	struct rand_dist *arrival, *service;	/* ns */
+
+	double slo_pct;
+	u64 slo;		/* ns, 0 for none */
+
+	int n_steps;
+	u64 step_len;		/* ns, 0 for a single step */
+	struct server_step steps[SERVER_MAX_STEPS];
+
+	wait_queue_head_t wq;
+	struct list_head queue;
+	int queued, max_queued;
+	struct hrtimer timer;
+	u64 start;
+};
+
+struct linsched_server *linsched_load_server(char *filename,
+					     const struct cpumask *cpus,
+					     unsigned int *rand_state);
+void linsched_print_server_report(struct linsched_server *srv);
+void linsched_destroy_server(struct linsched_server *srv);
+
+#endif	/* __LINSCHED_SERVER_H */
@@ -2,9 +2,13 @@
 #include "linsched_rand.h"
 #include "linsched_sim.h"
 #include "load_balance_score.h"
+#include "latency_tracking.h"
 #include <stdio.h>
+#include <math.h>
 #include <malloc.h>
 #include <assert.h>
+#include <unistd.h>
+#include <ctype.h>
 
 /* picks a random dist type */
 enum RND_TYPE pick_random_dist_type(unsigned int *rand_state)
@@ -95,34 +99,22 @@ int pick_n_tasks(unsigned int *rand_state)
 	return n_tasks;
 }
 
-/* creates a task group (with the specified shares) and a random
- * number of tasks having random run / sleep distributions. If
- * sleep_type and busy_type are specified, the tasks will have
- * distributions of those types, if they are MAX_RND_TYPE then they
- * are picked randomly */
-struct linsched_tg_sim *linsched_create_tg_sim(int shares,
-					       struct rand_dist *sleep_dist,
-					       struct rand_dist *busy_dist,
-					       unsigned int *rand_state,
-					       struct cgroup *cgroup,
-					       const struct cpumask *cpus)
+/* adds n_tasks tasks to a task group, with the given run / sleep
+ * distributions or random ones if they are NULL */
+static void tg_sim_add_tasks(struct linsched_tg_sim *tgsim, int n_tasks,
+			     struct rand_dist *sleep_dist,
+			     struct rand_dist *busy_dist,
+			     unsigned int *rand_state,
+			     const struct cpumask *cpus)
 {
-	int i;
-	int n_tasks = pick_n_tasks(rand_state);
-	struct linsched_tg_sim *tgsim = malloc(sizeof(struct linsched_tg_sim));
-
-	assert(tgsim);
-	if (cgroup)
-		tgsim->cg = cgroup;
-	else
-		tgsim->cg = linsched_create_cgroup(root_cgroup, NULL);
+	int i, first = tgsim->n_tasks;
 
-	sched_group_set_shares(cgroup_tg(tgsim->cg), shares);
-	tgsim->n_tasks = n_tasks;
-	tgsim->tasks = malloc(sizeof(struct task_struct*) * n_tasks);
+	tgsim->n_tasks += n_tasks;
+	tgsim->tasks = realloc(tgsim->tasks,
+			       sizeof(struct task_struct*) * tgsim->n_tasks);
 	assert(tgsim->tasks);
 
-	for (i = 0; i < n_tasks; i++) {
+	for (i = first; i < tgsim->n_tasks; i++) {
 		struct task_data *td;
 
 		if (!sleep_dist)
@@ -139,6 +131,44 @@ struct linsched_tg_sim *linsched_create_tg_sim(int shares,
 		set_cpus_allowed_ptr(tgsim->tasks[i], cpus);
 		linsched_add_task_to_group(tgsim->tasks[i], tgsim->cg);
 	}
+}
+
+static int cgroup_depth(struct cgroup *cg)
+{
+	int depth = 0;
+
+	for (; cg && cg != root_cgroup; cg = cg->parent)
+		depth++;
+	return depth;
+}
+
+/* creates a task group (with the specified shares) and n_tasks
+ * tasks (a random number if n_tasks is 0) having random run / sleep
+ * distributions. If sleep_type and busy_type are specified, the tasks
+ * will have distributions of those types, if they are MAX_RND_TYPE
+ * then they are picked randomly */
+struct linsched_tg_sim *linsched_create_tg_sim(int shares, int n_tasks,
+					       struct rand_dist *sleep_dist,
+					       struct rand_dist *busy_dist,
+					       unsigned int *rand_state,
+					       struct cgroup *cgroup,
+					       const struct cpumask *cpus)
+{
+	struct linsched_tg_sim *tgsim = calloc(1, sizeof(struct linsched_tg_sim));
+
+	if (!n_tasks)
+		n_tasks = pick_n_tasks(rand_state);
+	assert(tgsim);
+	if (cgroup)
+		tgsim->cg = cgroup;
+	else
+		tgsim->cg = linsched_create_cgroup(root_cgroup, NULL);
+
+	sched_group_set_shares(cgroup_tg(tgsim->cg), shares);
+	tgsim->shares = shares;
+	tgsim->depth = cgroup_depth(tgsim->cg);
+	tg_sim_add_tasks(tgsim, n_tasks, sleep_dist, busy_dist, rand_state,
+			 cpus);
 
 	return tgsim;
 }
@@ -165,7 +195,6 @@ void linsched_destroy_tg_sim(struct linsched_tg_sim *tgsim)
 	if (!tgsim)
 		return;
 
-	assert(tgsim->tasks);
 	for (i=0;i < tgsim->n_tasks;i++)
 		linsched_free_task_td(tgsim->tasks[i]);
 	free(tgsim->tasks);
@@ -189,7 +218,8 @@ static enum RND_TYPE parse_type(char **line_ptr)
 	} types[] = { { "GAUSSIAN ", GAUSSIAN },
 		      { "POISSON ", POISSON },
 		      { "EXPONENTIAL ", EXPONENTIAL },
-		      { "LOGNORMAL ", LOGNORMAL }};
+		      { "LOGNORMAL ", LOGNORMAL },
+		      { "EMPIRICAL ", EMPIRICAL }};
 
 	for(i = 0; i < sizeof(types)/sizeof(types[0]); i++) {
 		char *rest = remove_prefix(*line_ptr, types[i].name);
@@ -214,8 +244,54 @@ static int parse_double(char **line_ptr, double *val)
 	return 0;
 }
 
-static struct rand_dist *parse_distribution(char **line_ptr, unsigned int *rand_state)
+/* directory of the sim file being parsed, for relative histogram paths */
+static char sim_file_dir[256];
+
+/* returns true if successful */
+static int parse_path(char **line_ptr, char *path, size_t size)
+{
+	int len;
+	char *line = *line_ptr;
+	char fmt[16];
+
+	snprintf(fmt, sizeof(fmt), "%%%zus%%n", size - 1);
+	if (sscanf(line, fmt, path, &len) >= 1 && line[len] == ' ') {
+		*line_ptr += len + 1;
+		return 1;
+	}
+	return 0;
+}
+
+/* EMPIRICAL takes either a histogram / CDF file, or a pid.rlog file
+ * with an optional ":<event>" suffix selecting R (default), S or D
+ * events. Relative paths are tried as given, then relative to the
+ * directory of the sim file. */
+static struct rand_dist *load_empirical(char *path, unsigned int seed)
+{
+	char full[512], *suffix = strrchr(path, ':');
+	char event = 'R';
+	int is_rlog;
+
+	if (suffix && suffix[1] && !suffix[2]) {
+		event = suffix[1];
+		*suffix = '\0';
+	}
+	is_rlog = strstr(path, ".rlog") != NULL;
+
+	snprintf(full, sizeof(full), "%s", path);
+	if (path[0] != '/' && access(full, R_OK) && sim_file_dir[0])
+		snprintf(full, sizeof(full), "%s/%s", sim_file_dir, path);
+
+	if (is_rlog)
+		return linsched_load_empirical_rlog(full, event, seed);
+	return linsched_load_empirical(full, seed);
+}
+
+struct rand_dist *linsched_parse_distribution(char **line_ptr,
+					      unsigned int *rand_state)
 {
+	char path[256];
+	struct rand_dist *rdist;
 	enum RND_TYPE type = parse_type(line_ptr);
 	double arg1, arg2;
 	char *line = *line_ptr;
@@ -247,6 +323,25 @@ static struct rand_dist *parse_distribution(char **line_ptr, unsigned int *rand_
 			return linsched_init_lognormal(arg1, arg2, *rand_state);
 		}
 		return pick_lognormal_dist(rand_state);
+	case EMPIRICAL:
+		if (!parse_path(&line, path, sizeof(path))) {
+			/* skip a path that is too long, so that what follows
+			 * it still parses */
+			while (*line && !isspace(*line))
+				line++;
+			if (line != *line_ptr)
+				fprintf(stderr, "bad empirical distribution "
+					"path %.*s\n", (int)(line - *line_ptr),
+					*line_ptr);
+			*line_ptr = line + (*line == ' ');
+			return NULL;
+		}
+		*line_ptr = line;
+		rdist = load_empirical(path, *rand_state);
+		if (!rdist)
+			fprintf(stderr, "failed to load empirical "
+				"distribution %s\n", path);
+		return rdist;
 	default:
 		return NULL;
 	}
@@ -267,54 +362,245 @@ static struct cgroup *parse_fixed_cgroup(char **line_ptr)
 	return res;
 }
 
+static void add_tg_sim(struct linsched_sim *lsim,
+		       struct linsched_tg_sim *tgsim)
+{
+	lsim->tg_sim_arr = realloc(lsim->tg_sim_arr,
+				   (lsim->n_task_grps + 1) *
+				   sizeof(struct linsched_tg_sim *));
+	assert(lsim->tg_sim_arr);
+	lsim->tg_sim_arr[lsim->n_task_grps++] = tgsim;
+}
+
+static struct linsched_tg_sim *find_tg_sim(struct linsched_sim *lsim,
+					   struct cgroup *parent,
+					   const char *name, int len)
+{
+	int i;
+
+	for (i = 0; i < lsim->n_task_grps; i++) {
+		struct cgroup *cg = lsim->tg_sim_arr[i]->cg;
+		const char *cg_name = cgroup_name(cg);
+
+		if (cg->parent == parent && strlen(cg_name) == len &&
+		    !strncmp(cg_name, name, len))
+			return lsim->tg_sim_arr[i];
+	}
+	return NULL;
+}
+
+/* returns the group at path below base, creating it and any missing
+ * ancestors (with default shares and no tasks) */
+static struct linsched_tg_sim *get_tg_sim_path(struct linsched_sim *lsim,
+					       struct cgroup *base,
+					       char *path)
+{
+	struct linsched_tg_sim *tgsim = NULL, *parent = NULL;
+	struct cgroup *cg = base;
+	char name[64];
+
+	while (*path) {
+		int len = strcspn(path, "/");
+
+		if (len) {
+			tgsim = find_tg_sim(lsim, cg, path, len);
+			if (!tgsim) {
+				tgsim = calloc(1, sizeof(struct linsched_tg_sim));
+				assert(tgsim);
+				snprintf(name, sizeof(name), "%.*s", len, path);
+				tgsim->cg = linsched_create_cgroup(cg, name);
+				tgsim->parent = parent;
+				tgsim->depth = cgroup_depth(tgsim->cg);
+				tgsim->shares = scale_load_down(
+					cgroup_tg(tgsim->cg)->shares);
+				add_tg_sim(lsim, tgsim);
+			}
+			parent = tgsim;
+			cg = tgsim->cg;
+		}
+		path += len;
+		if (*path)
+			path++;
+	}
+	return tgsim;
+}
+
+static void set_tg_sim_shares(struct linsched_tg_sim *tgsim, long shares)
+{
+	sched_group_set_shares(cgroup_tg(tgsim->cg), shares);
+	tgsim->shares = shares;
+}
+
+/* parses "GROUP <path> <shares>", returns true if successful */
+static int parse_group_line(struct linsched_sim *lsim, struct cgroup *base,
+			    char *line)
+{
+	char path[256];
+	struct linsched_tg_sim *tgsim;
+
+	line = remove_prefix(line, "GROUP ");
+	if (!line || !parse_path(&line, path, sizeof(path)))
+		return 0;
+	tgsim = get_tg_sim_path(lsim, base, path);
+	if (tgsim)
+		set_tg_sim_shares(tgsim, simple_strtoul(line, NULL, 0));
+	return 1;
+}
+
+/* parses "BANDWIDTH <path> <quota us> [<period us>]", returns true if
+ * successful */
+static int parse_bandwidth_line(struct linsched_sim *lsim,
+				struct cgroup *base, char *line)
+{
+	char path[256];
+	struct linsched_tg_sim *tgsim;
+	long quota, period;
+
+	line = remove_prefix(line, "BANDWIDTH ");
+	if (!line || !parse_path(&line, path, sizeof(path)))
+		return 0;
+	quota = simple_strtol(line, &line, 0);
+	period = simple_strtol(line, NULL, 0);
+	tgsim = get_tg_sim_path(lsim, base, path);
+	if (tgsim && linsched_set_task_group_bandwidth(tgsim->cg, period,
+						       quota))
+		fprintf(stderr, "invalid bandwidth for %s\n", path);
+	return 1;
+}
+
+/* parses "RT_RUNTIME <path> <runtime us> [<period us>]", returns true
+ * if successful */
+static int parse_rt_runtime_line(struct linsched_sim *lsim,
+				 struct cgroup *base, char *line)
+{
+	char path[256];
+	struct linsched_tg_sim *tgsim;
+	long runtime, period;
+
+	line = remove_prefix(line, "RT_RUNTIME ");
+	if (!line || !parse_path(&line, path, sizeof(path)))
+		return 0;
+	runtime = simple_strtol(line, &line, 0);
+	period = simple_strtol(line, NULL, 0);
+	tgsim = get_tg_sim_path(lsim, base, path);
+	if (tgsim && linsched_set_task_group_rt_runtime(tgsim->cg, period,
+							runtime))
+		fprintf(stderr, "invalid rt runtime for %s\n", path);
+	return 1;
+}
+
 /* creates a linsched_sim object based on a shares file.
  * The structure of tg-shares file is specified as:
  * [ROOT |ONE_GROUP ]<N_TASK_GROUPS>
- * [sleep dist ][run dist ]<SHARES_OF_TG1>
- * [sleep dist ][run dist ]<SHARES_OF_TG2>
+ * [/path ][sleep dist ][run dist ]<SHARES_OF_TG1>
+ * [/path ][sleep dist ][run dist ]<SHARES_OF_TG2>
  * .......
  * .......
- * [sleep dist ][run dist ]<SHARES_OF_TGN>
+ * [/path ][sleep dist ][run dist ]<SHARES_OF_TGN>
+ * Each line may end with " <N_TASKS>" to fix the number of tasks in
+ * the group instead of picking it at random.
  * Where a distribution is one of GUASSIAN, POISSON etc, with optional
- * parameters
+ * parameters, or "EMPIRICAL <file>" (see linsched_load_empirical() and
+ * linsched_load_empirical_rlog() for the file formats). A distribution
+ * without parameters is picked at random; an EMPIRICAL file that cannot
+ * be loaded fails the whole sim file.
+ *
+ * Task groups are flat by default. A line starting with a path such
+ * as /prod/svc/worker puts its tasks in that cgroup (below the
+ * ONE_GROUP group if given), creating missing ancestors with default
+ * shares. Lines of the form "GROUP <path> <SHARES>" set the shares of
+ * an interior group; they don't count towards N_TASK_GROUPS.
+ * Likewise "BANDWIDTH <path> <QUOTA_US> [<PERIOD_US>]" sets a cfs
+ * bandwidth limit on a group, and "RT_RUNTIME <path> <RUNTIME_US>
+ * [<PERIOD_US>]" its RT runtime.
+ * Interior groups are kept in tg_sim_arr with no tasks.
  */
+/* like linsched_parse_distribution(), but returns -1 for an EMPIRICAL
+ * distribution that cannot be loaded, so that a bad path fails the sim
+ * file rather than silently becoming a random distribution */
+static int parse_sim_distribution(char **line_ptr, unsigned int *rand_state,
+				  struct rand_dist **rdist)
+{
+	int empirical = remove_prefix(*line_ptr, "EMPIRICAL ") != NULL;
+
+	*rdist = linsched_parse_distribution(line_ptr, rand_state);
+	return empirical && !*rdist ? -1 : 0;
+}
+
 struct linsched_sim *linsched_create_sim(char *tg_file, const struct cpumask *cpus,
 					 unsigned int *rand_state)
 {
 	FILE *tg_filp;
 	char line[256];
 	long shares;
-	int n_tsk_grps;
-	int i = 0;
-	struct linsched_sim *lsim = malloc(sizeof(struct linsched_sim));
-	struct linsched_tg_sim **tg_sim_arr = NULL;
+	int n_tsk_grps = 0;
+	int i = 0, lineno = 1;
+	struct linsched_sim *lsim = calloc(1, sizeof(struct linsched_sim));
 	struct cgroup *group = NULL;
+	char *slash = strrchr(tg_file, '/');
+
+	sim_file_dir[0] = '\0';
+	if (slash)
+		snprintf(sim_file_dir, sizeof(sim_file_dir), "%.*s",
+			 (int)(slash - tg_file), tg_file);
 
 	if ((tg_filp = fopen(tg_file, "r")) != NULL) {
 		if (fgets(line, sizeof(line), tg_filp)) {
 			char *parsed_line = line;
 			group = parse_fixed_cgroup(&parsed_line);
 			n_tsk_grps = simple_strtoul(parsed_line, NULL, 0);
-			if (n_tsk_grps)
-				tg_sim_arr = malloc(n_tsk_grps *
-					sizeof(struct linsched_tg_sim *));
 		}
-		if (!tg_sim_arr)
+		if (!n_tsk_grps)
 			return NULL;
 		while (fgets(line, sizeof(line), tg_filp) && i < n_tsk_grps) {
-			struct rand_dist *sleep_dist, *run_dist;
+			struct rand_dist *sleep_dist, *run_dist = NULL;
+			struct linsched_tg_sim *tgsim = NULL;
 			char *parsed_line = line;
-
-			sleep_dist = parse_distribution(&parsed_line, rand_state);
-			run_dist = parse_distribution(&parsed_line, rand_state);
-			shares = simple_strtoul(parsed_line, NULL, 0);
-			tg_sim_arr[i++] =
-				linsched_create_tg_sim(shares, sleep_dist,
-						       run_dist, rand_state,
-						       group, cpus);
+			char path[256];
+			int n_tasks;
+
+			lineno++;
+			if (parse_group_line(lsim, group ? group : root_cgroup,
+					     line) ||
+			    parse_bandwidth_line(lsim, group ? group :
+						 root_cgroup, line) ||
+			    parse_rt_runtime_line(lsim, group ? group :
+						  root_cgroup, line))
+				continue;
+			if (line[0] == '/' &&
+			    parse_path(&parsed_line, path, sizeof(path)))
+				tgsim = get_tg_sim_path(lsim, group ? group :
+							root_cgroup, path);
+
+			if (parse_sim_distribution(&parsed_line, rand_state,
+						   &sleep_dist) ||
+			    parse_sim_distribution(&parsed_line, rand_state,
+						   &run_dist)) {
+				fprintf(stderr, "%s:%d: bad distribution: %s",
+					tg_file, lineno, line);
+				if (sleep_dist)
+					linsched_destroy_dist(sleep_dist);
+				fclose(tg_filp);
+				linsched_destroy_sim(lsim);
+				return NULL;
+			}
+			shares = simple_strtoul(parsed_line, &parsed_line, 0);
+			n_tasks = simple_strtoul(parsed_line, NULL, 0);
+			if (tgsim) {
+				set_tg_sim_shares(tgsim, shares);
+				if (!n_tasks)
+					n_tasks = pick_n_tasks(rand_state);
+				tg_sim_add_tasks(tgsim, n_tasks, sleep_dist,
+						 run_dist, rand_state, cpus);
+			} else {
+				add_tg_sim(lsim,
+					   linsched_create_tg_sim(shares, n_tasks,
+							sleep_dist, run_dist,
+							rand_state, group,
+							cpus));
+			}
+			i++;
 		}
-		lsim->n_task_grps = n_tsk_grps;
-		lsim->tg_sim_arr = tg_sim_arr;
 		fclose(tg_filp);
 		return lsim;
 	}
@@ -345,6 +631,7 @@ void print_dist_params(struct rand_dist *rdist)
 	struct gaussian_dist *gdist;
 	struct poisson_dist *pdist;
 	struct exp_dist *edist;
+	struct empirical_dist *emdist;
 
 	switch (type) {
 	case LOGNORMAL:
@@ -366,6 +653,11 @@ void print_dist_params(struct rand_dist *rdist)
 		edist = rdist->dist;
 		fprintf(stdout, "EXPONENTIAL: mean = %d", edist->mu);
 		break;
+	case EMPIRICAL:
+		emdist = rdist->dist;
+		fprintf(stdout, "EMPIRICAL: bins = %d, mean = %f",
+			emdist->table->n, emdist->table->mean);
+		break;
 	}
 }
 
@@ -386,9 +678,49 @@ void print_task_params(struct task_struct *p, struct cgroup *cgrp)
 	print_dist_params(rd->busy_rdist);
 }
 
+/* prints the runtime of every group in a hierarchical sim, as a
+ * fraction of its parent's, and the runtime of each level */
+static void print_hierarchy_report(struct linsched_sim *lsim, int max_depth)
+{
+	u64 *level_time = calloc(max_depth + 1, sizeof(u64));
+	int *level_groups = calloc(max_depth + 1, sizeof(int));
+	int *level_tasks = calloc(max_depth + 1, sizeof(int));
+	u64 total = group_exec_time(cgroup_tg(root_cgroup));
+	char buf[128];
+	int i;
+
+	fprintf(stdout, "------ group hierarchy\n");
+	for (i = 0; i < lsim->n_task_grps; i++) {
+		struct linsched_tg_sim *tgsim = lsim->tg_sim_arr[i];
+		u64 time = group_exec_time(cgroup_tg(tgsim->cg));
+		u64 parent_time = tgsim->cg->parent ?
+			group_exec_time(cgroup_tg(tgsim->cg->parent)) : time;
+
+		cgroup_path(tgsim->cg, buf, 128);
+		fprintf(stdout, "%*s%s: depth = %d, shares = %lu, tasks = %d, "
+			"exec_time = %llu (%.2f%% of parent)\n",
+			2 * tgsim->depth, "", buf, tgsim->depth, tgsim->shares,
+			tgsim->n_tasks, time,
+			parent_time ? time * 100.0 / parent_time : 0.0);
+
+		level_time[tgsim->depth] += time;
+		level_groups[tgsim->depth]++;
+		level_tasks[tgsim->depth] += tgsim->n_tasks;
+	}
+	for (i = 1; i <= max_depth; i++)
+		fprintf(stdout, "Level %d: groups = %d, tasks = %d, "
+			"exec_time = %llu (%.2f%% of total)\n", i,
+			level_groups[i], level_tasks[i], level_time[i],
+			total ? level_time[i] * 100.0 / total : 0.0);
+
+	free(level_time);
+	free(level_groups);
+	free(level_tasks);
+}
+
 void print_report(struct linsched_sim *lsim)
 {
-	int i, j;
+	int i, j, max_depth = 0;
 	struct linsched_tg_sim *tgsim;
 
 	linsched_print_task_stats();
@@ -401,6 +733,178 @@ void print_report(struct linsched_sim *lsim)
 
 		for (j = 0; j < tgsim->n_tasks; j++)
 			print_task_params(tgsim->tasks[j], tgsim->cg);
+		max_depth = max(max_depth, tgsim->depth);
+	}
+	fprintf(stdout, "\n");
+
+	if (max_depth > 1)
+		print_hierarchy_report(lsim, max_depth);
+}
+
+/* batch means */
+
+struct batch_stat {
+	const char *name;
+	char buf[160];
+	double sum, sumsq;
+	int n;
+};
+
+static void batch_add(struct batch_stat *s, double v)
+{
+	s->sum += v;
+	s->sumsq += v * v;
+	s->n++;
+}
+
+/* half width of the 95% confidence interval of the mean of the batches */
+static double batch_halfwidth(struct batch_stat *s)
+{
+	/* Student t 97.5% quantiles by degrees of freedom */
+	static const double t975[] = {
+		0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+		2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110,
+		2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056,
+		2.052, 2.048, 2.045, 2.042,
+	};
+	int df = s->n - 1;
+	double var, t;
+
+	if (df < 1)
+		return INFINITY;
+	t = df < ARRAY_SIZE(t975) ? t975[df] : 1.96 + 2.37 / df;
+	var = (s->sumsq - s->sum * s->sum / s->n) / df;
+	return t * sqrt(max(var, 0.0) / s->n);
+}
+
+static int batch_converged(struct batch_stat *s, double precision)
+{
+	double mean, hw;
+
+	if (s->n < MIN_BATCHES)
+		return 0;
+	mean = s->sum / s->n;
+	hw = batch_halfwidth(s);
+	return mean ? hw <= fabs(mean) * precision / 100 : hw == 0;
+}
+
+struct linsched_batch_means {
+	int n_stats;
+	struct batch_stat *stats;
+	int warmup, batch, duration, converged;
+	double precision;
+};
+
+/*
+ * Runs the sim in batches of batch ms after warmup ms, until the 95%
+ * confidence interval of the batch means of every metric (imbalance,
+ * mean wakeup latency and the runtime share of each group) is within
+ * precision percent of its mean, or max_duration ms have been
+ * simulated. The result is printed (and freed) by
+ * linsched_print_batch_means().
+ */
+struct linsched_batch_means *
+linsched_run_sim_batches(struct linsched_sim *lsim, int warmup, int batch,
+			 int max_duration, double precision)
+{
+	struct linsched_batch_means *bm = calloc(1, sizeof(*bm));
+	int n_stats = 2 + lsim->n_task_grps;
+	struct batch_stat *stats = calloc(n_stats, sizeof(*stats));
+	u64 *prev_exec = calloc(n_stats, sizeof(u64));
+	struct task_group *root = cgroup_tg(root_cgroup);
+	u64 prev_time, prev_count, prev_sum, count, sum, root_time;
+	double prev_imbalance;
+	int i, duration = min(warmup, max_duration), converged = 0;
+
+	BUG_ON(!bm || !stats || !prev_exec);
+	stats[0].name = "imbalance";
+	stats[1].name = "wakeup latency";
+	for (i = 0; i < lsim->n_task_grps; i++) {
+		struct batch_stat *s = &stats[2 + i];
+
+		/* groups of root tasks have no share to measure */
+		if (lsim->tg_sim_arr[i]->cg == root_cgroup)
+			continue;
+		strcpy(s->buf, "share ");
+		cgroup_path(lsim->tg_sim_arr[i]->cg, s->buf + 6,
+			    sizeof(s->buf) - 6);
+		s->name = s->buf;
+	}
+
+	if (duration)
+		linsched_run_sim(duration);
+	while (!converged && duration < max_duration) {
+		int len = min(batch, max_duration - duration);
+
+		prev_time = current_time;
+		prev_imbalance = get_total_imbalance();
+		latency_totals(1, &prev_count, &prev_sum);
+		prev_exec[0] = group_exec_time(root);
+		for (i = 0; i < lsim->n_task_grps; i++)
+			prev_exec[2 + i] =
+				group_exec_time(cgroup_tg(lsim->tg_sim_arr[i]->cg));
+
+		linsched_run_sim(len);
+		duration += len;
+
+		batch_add(&stats[0], (get_total_imbalance() - prev_imbalance) /
+			  (current_time - prev_time));
+		latency_totals(1, &count, &sum);
+		if (count > prev_count)
+			batch_add(&stats[1],
+				  (double)(sum - prev_sum) / (count - prev_count));
+		root_time = group_exec_time(root) - prev_exec[0];
+		for (i = 0; root_time && i < lsim->n_task_grps; i++) {
+			u64 time = group_exec_time(
+				cgroup_tg(lsim->tg_sim_arr[i]->cg));
+
+			if (!stats[2 + i].name)
+				continue;
+			batch_add(&stats[2 + i],
+				  (double)(time - prev_exec[2 + i]) / root_time);
+		}
+
+		converged = 1;
+		for (i = 0; i < n_stats; i++)
+			/* a metric without samples (no wakeups) can't hold
+			 * the sim back */
+			if (stats[i].n && !batch_converged(&stats[i], precision))
+				converged = 0;
+	}
+	free(prev_exec);
+
+	bm->n_stats = n_stats;
+	bm->stats = stats;
+	bm->warmup = min(warmup, max_duration);
+	bm->batch = batch;
+	bm->duration = duration;
+	bm->converged = converged;
+	bm->precision = precision;
+	return bm;
+}
+
+void linsched_print_batch_means(struct linsched_batch_means *bm)
+{
+	int i;
+
+	fprintf(stdout, "------ batch means\n");
+	fprintf(stdout, "%s after %d ms: %d batches of %d ms after %d ms "
+		"warmup, target precision %.2f%%\n",
+		bm->converged ? "converged" : "budget exhausted", bm->duration,
+		bm->stats[0].n, bm->batch, bm->warmup, bm->precision);
+	for (i = 0; i < bm->n_stats; i++) {
+		struct batch_stat *s = &bm->stats[i];
+		double mean, hw;
+
+		if (!s->n)
+			continue;
+		mean = s->sum / s->n;
+		hw = batch_halfwidth(s);
+		fprintf(stdout, "%s: mean = %g, +/- %g (%.2f%%)\n", s->name,
+			mean, hw, mean ? hw * 100 / fabs(mean) : 0.0);
 	}
 	fprintf(stdout, "\n");
+
+	free(bm->stats);
+	free(bm);
 }
@@ -25,6 +25,9 @@
 #define MIN_LOGNORMAL_DIST_SDLOG 1
 #define MAX_LOGNORMAL_DIST_SDLOG 4
 
+/* batch means need this many batches for a confidence interval */
+#define MIN_BATCHES 5
+
 #define TOPO_ARGO "argo"
 #define TOPO_IKARIA "ikaria"
 
@@ -32,14 +35,20 @@ struct linsched_tg_sim {
 	int n_tasks;
 	struct cgroup *cg;
 	struct task_struct **tasks;
+	/* position in the hierarchy; parent is NULL for top level groups */
+	struct linsched_tg_sim *parent;
+	int depth;
+	unsigned long shares;
 };
 
+struct linsched_batch_means;
+
 struct linsched_sim {
 	int n_task_grps;
 	struct linsched_tg_sim **tg_sim_arr;
 };
 
-struct linsched_tg_sim *linsched_create_tg_sim(int shares,
+struct linsched_tg_sim *linsched_create_tg_sim(int shares, int n_tasks,
 					       struct rand_dist *sleep_dist,
 					       struct rand_dist *busy_dist,
 					       unsigned int *rand_state,
@@ -48,8 +57,15 @@ struct linsched_tg_sim *linsched_create_tg_sim(int shares,
 struct linsched_sim *linsched_create_sim(char *tg_file, const struct cpumask *cpus,
 					 unsigned int *rand_state);
 void linsched_destroy_rnd_sim_task(struct task_struct *p);
+/* parses "<TYPE> [<args>] " off *line_ptr, see linsched_create_sim() */
+struct rand_dist *linsched_parse_distribution(char **line_ptr,
+					      unsigned int *rand_state);
 void linsched_destroy_tg_sim(struct linsched_tg_sim *tgsim);
 void linsched_destroy_sim(struct linsched_sim *lsim);
 void print_report(struct linsched_sim *lsim);
+struct linsched_batch_means *
+linsched_run_sim_batches(struct linsched_sim *lsim, int warmup, int batch,
+			 int max_duration, double precision);
+void linsched_print_batch_means(struct linsched_batch_means *bm);
 
 #endif	/* __LINSCHED_SIM_H */
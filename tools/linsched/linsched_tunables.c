@@ -0,0 +1,180 @@
+/* Scheduler tunables for linsched
+ *
+ * Sets scheduler sysctls and SCHED_FEAT bits by name, with the same
+ * handlers and limits as writes to /proc/sys/kernel/sched_* and
+ * /sys/kernel/debug/sched_features.
+ */
+
+#include "linsched.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int min_sched_granularity_ns = 100000;
+static int max_sched_granularity_ns = NSEC_PER_SEC;
+static int min_wakeup_granularity_ns;
+static int max_wakeup_granularity_ns = NSEC_PER_SEC;
+static int min_sched_tunable_scaling = SCHED_TUNABLESCALING_NONE;
+static int max_sched_tunable_scaling = SCHED_TUNABLESCALING_END - 1;
+static int zero;
+static int one = 1;
+
+/* as in kern_table[] in kernel/sysctl.c */
+static struct ctl_table sched_sysctls[] = {
+	{
+		.procname	= "sched_child_runs_first",
+		.data		= &sysctl_sched_child_runs_first,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "sched_min_granularity_ns",
+		.data		= &sysctl_sched_min_granularity,
+		.proc_handler	= sched_proc_update_handler,
+		.extra1		= &min_sched_granularity_ns,
+		.extra2		= &max_sched_granularity_ns,
+	},
+	{
+		.procname	= "sched_latency_ns",
+		.data		= &sysctl_sched_latency,
+		.proc_handler	= sched_proc_update_handler,
+		.extra1		= &min_sched_granularity_ns,
+		.extra2		= &max_sched_granularity_ns,
+	},
+	{
+		.procname	= "sched_wakeup_granularity_ns",
+		.data		= &sysctl_sched_wakeup_granularity,
+		.proc_handler	= sched_proc_update_handler,
+		.extra1		= &min_wakeup_granularity_ns,
+		.extra2		= &max_wakeup_granularity_ns,
+	},
+	{
+		.procname	= "sched_tunable_scaling",
+		.data		= &sysctl_sched_tunable_scaling,
+		.proc_handler	= sched_proc_update_handler,
+		.extra1		= &min_sched_tunable_scaling,
+		.extra2		= &max_sched_tunable_scaling,
+	},
+	{
+		.procname	= "sched_migration_cost",
+		.data		= &sysctl_sched_migration_cost,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "sched_nr_migrate",
+		.data		= &sysctl_sched_nr_migrate,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "sched_time_avg",
+		.data		= &sysctl_sched_time_avg,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "sched_shares_window",
+		.data		= &sysctl_sched_shares_window,
+		.proc_handler	= proc_dointvec,
+	},
+	{
+		.procname	= "sched_rt_period_us",
+		.data		= &sysctl_sched_rt_period,
+		.proc_handler	= sched_rt_handler,
+	},
+	{
+		.procname	= "sched_rt_runtime_us",
+		.data		= &sysctl_sched_rt_runtime,
+		.proc_handler	= sched_rt_handler,
+	},
+	{
+		.procname	= "sched_autogroup_enabled",
+		.data		= &sysctl_sched_autogroup_enabled,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "sched_cfs_bandwidth_slice_us",
+		.data		= &sysctl_sched_cfs_bandwidth_slice,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+	},
+};
+
+#define SCHED_FEAT(name, enabled)	#name,
+static const char *sched_feat_names[] = {
+#include "../kernel/sched/features.h"
+};
+#undef SCHED_FEAT
+
+/* sets the sysctl name (without the kernel. prefix) to value, as
+ * "sysctl -w", returns 0 or -errno */
+int linsched_set_sysctl(const char *name, const char *value)
+{
+	size_t len = strlen(value);
+	loff_t pos = 0;
+	int i;
+
+	if (!strncmp(name, "kernel.", 7))
+		name += 7;
+	for (i = 0; i < ARRAY_SIZE(sched_sysctls); i++) {
+		struct ctl_table *table = &sched_sysctls[i];
+		int old = *(int *)table->data;
+		int ret;
+
+		if (strcmp(name, table->procname))
+			continue;
+		ret = table->proc_handler(table, 1, (char *)value, &len, &pos);
+		/* the rt handler restores the old value itself */
+		if (ret)
+			*(int *)table->data = old;
+		return ret;
+	}
+	return -ENOENT;
+}
+
+/* sets a SCHED_FEAT bit, or clears it for NO_<name>, as a write to
+ * sched_features; returns 0 or -errno */
+int linsched_set_sched_feat(const char *name)
+{
+	int neg = !strncmp(name, "NO_", 3);
+	int i;
+
+	if (neg)
+		name += 3;
+	for (i = 0; i < ARRAY_SIZE(sched_feat_names); i++) {
+		if (strcmp(name, sched_feat_names[i]))
+			continue;
+		if (neg)
+			sysctl_sched_features &= ~(1UL << i);
+		else
+			sysctl_sched_features |= (1UL << i);
+		return 0;
+	}
+	return -ENOENT;
+}
+
+/* applies --sysctl and --sched_feat, once the scheduler is up */
+void linsched_apply_global_tunables(void)
+{
+	struct linsched_global_options *opt = &linsched_global_options;
+	char name[64];
+	int i;
+
+	for (i = 0; i < opt->n_sysctls; i++) {
+		char *eq = strchr(opt->sysctls[i], '=');
+
+		if (eq && eq - opt->sysctls[i] < sizeof(name)) {
+			snprintf(name, sizeof(name), "%.*s",
+				 (int)(eq - opt->sysctls[i]), opt->sysctls[i]);
+			if (!linsched_set_sysctl(name, eq + 1))
+				continue;
+		}
+		fprintf(stderr, "invalid sysctl: %s\n", opt->sysctls[i]);
+		exit(1);
+	}
+	for (i = 0; i < opt->n_sched_feats; i++) {
+		if (linsched_set_sched_feat(opt->sched_feats[i])) {
+			fprintf(stderr, "invalid sched_feat: %s\n",
+				opt->sched_feats[i]);
+			exit(1);
+		}
+	}
+}
@@ -40,6 +40,7 @@
 #include <assert.h>
 
 #include "linsched_rand.h"
+#include "linsched_io.h"
 #include "load_balance_score.h"
 
 /* linsched variables and functions */
@@ -49,6 +50,9 @@ bool simulation_started = true;
 
 struct task_struct *__linsched_tasks[LINSCHED_MAX_TASKS];
 int curr_task_id;
+/* ids of exited tasks, handed out again before num_tasks grows */
+static int free_task_ids[LINSCHED_MAX_TASKS];
+static int nr_free_task_ids;
 
 struct linsched_cgroup __linsched_cgroups[LINSCHED_MAX_GROUPS];
 int num_cgroups = 1, num_tasks = 1;
@@ -97,6 +101,7 @@ void linsched_init(struct linsched_topology *topo)
 
 	init_lb_info();
 	init_stop_tasks();
+	linsched_apply_global_tunables();
 }
 
 void linsched_default_callback(void)
@@ -122,8 +127,9 @@ void linsched_disable_migrations(void)
 	int i;
 
 	for (i = 1; i < num_tasks; i++)
-		set_cpus_allowed(__linsched_tasks[i],
-				 cpumask_of_cpu(task_cpu(__linsched_tasks[i])));
+		if (__linsched_tasks[i])
+			set_cpus_allowed(__linsched_tasks[i],
+				cpumask_of_cpu(task_cpu(__linsched_tasks[i])));
 }
 
 void linsched_enable_migrations(void)
@@ -131,7 +137,8 @@ void linsched_enable_migrations(void)
 	int i;
 
 	for (i = 1; i < num_tasks; i++)
-		set_cpus_allowed(__linsched_tasks[i], CPU_MASK_ALL);
+		if (__linsched_tasks[i])
+			set_cpus_allowed(__linsched_tasks[i], CPU_MASK_ALL);
 }
 
 /* Force a migration of task to the dest_cpu.
@@ -170,14 +177,20 @@ static struct task_struct *linsched_fork(struct task_data *td, int enqueue_start
 	struct task_struct *p;
 
 	//p = linsched_raw_copy_process();
-	p = find_task_by_vpid(do_fork(0, 0, NULL, 0, NULL, NULL));
+	/* tasks forking tasks (see linsched_churn.h) share init_mm with
+	 * them, rather than duplicating it */
+	p = find_task_by_vpid(do_fork(CLONE_VM, 0, NULL, 0, NULL, NULL));
 
 	task_thread_info(p)->td = td;
 	/*
 	 * This is fine *only* because we don't care about mm
 	 * TODO: Might have to fix this assumption
 	 */
-	p->mm = &init_mm;
+	if (!p->mm) {
+		p->mm = &init_mm;
+		/* dropped by exit_mm() */
+		atomic_inc(&init_mm.mm_users);
+	}
 	p->active_mm = &init_mm;
 
 	if (!enqueue_start) {
@@ -207,6 +220,40 @@ static struct task_struct *__linsched_create_task(struct task_data *td)
 	return newtask;
 }
 
+static int linsched_alloc_task_id(void)
+{
+	int id = nr_free_task_ids ? free_task_ids[--nr_free_task_ids] :
+		num_tasks++;
+
+	assert(id < LINSCHED_MAX_TASKS);
+	return id;
+}
+
+/* how many more tasks can be created */
+int linsched_task_ids_left(void)
+{
+	return LINSCHED_MAX_TASKS - num_tasks + nr_free_task_ids;
+}
+
+extern void linsched_do_exit(long code);	/* kernel/exit.c */
+
+/* Ends p, which must be current (i.e. be called from its handle_task),
+ * through do_exit(). Its task id and pid are reused by tasks created
+ * later. The task_data is left to the caller, as are any timers it
+ * armed. On return another task is current. */
+void linsched_exit_task(struct task_struct *p)
+{
+	int id = task_thread_info(p)->id;
+
+	BUG_ON(p != current);
+	BUG_ON(__linsched_tasks[id] != p);
+	__linsched_tasks[id] = NULL;
+	free_task_ids[nr_free_task_ids++] = id;
+	task_thread_info(p)->td = NULL;
+
+	linsched_do_exit(0);
+}
+
 extern void linsched_check_idle_cpu(void);
 void linsched_check_resched(void)
 {
@@ -267,6 +314,12 @@ int linsched_add_task_to_group(struct task_struct *p, struct cgroup *cgrp)
 	struct task_group *tg = cgroup_tg(cgrp);
 	struct cpuacct *ca = cgroup_ca(cgrp);
 
+#ifdef CONFIG_RT_GROUP_SCHED
+	/* as in cpu_cgroup_can_attach() */
+	if (!sched_rt_can_attach(tg, p))
+		return -EINVAL;
+#endif
+
 	p->cgroups->subsys[cpu_cgroup_subsys_id] = &tg->css;
 	p->cgroups->subsys[cpuacct_subsys_id] = &ca->css;
 	sched_move_task(p);
@@ -274,6 +327,97 @@ int linsched_add_task_to_group(struct task_struct *p, struct cgroup *cgrp)
 	return 0;
 }
 
+void linsched_set_task_group_shares(int groupid, unsigned long shares)
+{
+	assert(groupid < num_cgroups);
+	sched_group_set_shares(cgroup_tg(&__linsched_cgroups[groupid].cg),
+			       shares);
+}
+
+/* Limits a task group to quota_us of runtime every period_us, like
+ * cpu.cfs_quota_us and cpu.cfs_period_us. A negative quota removes the
+ * limit and a zero period keeps the current one. Returns 0 or -errno.
+ */
+int linsched_set_task_group_bandwidth(struct cgroup *cgrp, long period_us,
+				      long quota_us)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	int ret;
+
+	/* drop the old quota first so that the new period is only ever
+	 * checked against the new quota */
+	ret = tg_set_cfs_quota(tg, -1);
+	if (!ret && period_us)
+		ret = tg_set_cfs_period(tg, period_us);
+	if (!ret && quota_us >= 0)
+		ret = tg_set_cfs_quota(tg, quota_us);
+
+	return ret;
+}
+
+/* Gives a task group runtime_us of RT runtime every period_us, like
+ * cpu.rt_runtime_us and cpu.rt_period_us. A negative runtime is
+ * unlimited and a zero period keeps the current one. RT tasks can only
+ * join groups with a runtime. Returns 0 or -errno.
+ */
+int linsched_set_task_group_rt_runtime(struct cgroup *cgrp, long period_us,
+				       long runtime_us)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	int ret = 0;
+
+	/* order the updates so that the runtime never exceeds the
+	 * period in between */
+	if (period_us && period_us < sched_group_rt_period(tg)) {
+		ret = sched_group_set_rt_runtime(tg, runtime_us);
+		if (!ret)
+			ret = sched_group_set_rt_period(tg, period_us);
+	} else {
+		if (period_us)
+			ret = sched_group_set_rt_period(tg, period_us);
+		if (!ret)
+			ret = sched_group_set_rt_runtime(tg, runtime_us);
+	}
+
+	return ret;
+}
+
+/* Moves p into a new autogroup, as if it had called setsid(). The
+ * autogroup gets a cgroup slot named autogroup-<id> below the root so
+ * that it shows up in the group stats and in the imbalance score.
+ * Tasks only run in their autogroup while they are in the root cgroup
+ * and not RT.
+ */
+struct cgroup *linsched_create_autogroup(struct task_struct *p)
+{
+	struct task_group *tg;
+	struct cgroup *cg;
+	char buf[32];
+
+	sched_autogroup_create_attach(p);
+	tg = p->signal->autogroup->tg;
+	if (!task_group_is_autogroup(tg))
+		return root_cgroup;
+
+	/* cgroup slots are never freed, so the slot holds a reference on
+	 * the autogroup; the next setsid() would free it otherwise */
+	assert(num_cgroups < LINSCHED_MAX_GROUPS);
+	kref_get(&tg->autogroup->kref);
+
+	cg = &__linsched_cgroups[num_cgroups++].cg;
+	cg->parent = root_cgroup;
+	cg->subsys[cpu_cgroup_subsys_id] = &tg->css;
+	cg->subsys[cpuacct_subsys_id] = root_cgroup->subsys[cpuacct_subsys_id];
+	tg->css.cgroup = cg;
+
+	sprintf(buf, "autogroup-%lu", tg->autogroup->id);
+	cg->dentry = malloc(sizeof(struct dentry));
+	cg->dentry->d_name.name = strdup(buf);
+	cg->dentry->d_name.len = strlen(buf);
+
+	return cg;
+}
+
 u64 task_exec_time(struct task_struct *p)
 {
 	return p->se.sum_exec_runtime;
@@ -304,6 +448,10 @@ void linsched_print_task_stats(void)
 	long total_time = 0;
 	for (i = 1; i < num_tasks; i++) {
 		struct task_struct *task = __linsched_tasks[i];
+
+		/* exited */
+		if (!task)
+			continue;
 		printf
 		    ("Task id = %d (%d), exec_time = %llu, run_delay = %llu, pcount = %lu\n",
 		     task_pid_nr(task), i, task_exec_time(task), task->sched_info.run_delay,
@@ -330,6 +478,75 @@ void linsched_print_group_stats(void)
 	}
 }
 
+/* Prints the cfs bandwidth statistics (as in cpu.stat) of every group
+ * that has, or has had, a quota. throttled_time includes throttles
+ * that are still in progress. */
+void linsched_print_bandwidth_stats(void)
+{
+	char buf[128];
+	int i, cpu;
+
+	for (i = 1; i < num_cgroups; i++) {
+		struct task_group *tg = cgroup_tg(&__linsched_cgroups[i].cg);
+		struct cfs_bandwidth *cfs_b = &tg->cfs_bandwidth;
+		u64 throttled_time = cfs_b->throttled_time;
+
+		if (cfs_b->quota == RUNTIME_INF && !cfs_b->nr_periods)
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			struct cfs_rq *cfs_rq = tg->cfs_rq[cpu];
+
+			if (cfs_rq->throttled)
+				throttled_time += cfs_rq->rq->clock -
+					cfs_rq->throttled_timestamp;
+		}
+
+		cgroup_path(tg->css.cgroup, buf, 128);
+		printf("CGroup = %s (%d), period = %ld us, quota = %ld us, "
+		       "nr_periods = %d, nr_throttled = %d, "
+		       "throttled_time = %llu\n", buf, i,
+		       tg_get_cfs_period(tg), tg_get_cfs_quota(tg),
+		       cfs_b->nr_periods, cfs_b->nr_throttled, throttled_time);
+	}
+}
+
+/* Prints the RT bandwidth and throttling statistics of every group
+ * that can run RT tasks. throttled_time includes throttles that are
+ * still in progress. */
+void linsched_print_rt_stats(void)
+{
+	char buf[128];
+	int i, cpu;
+
+	for (i = 0; i < num_cgroups; i++) {
+		struct task_group *tg = cgroup_tg(&__linsched_cgroups[i].cg);
+		u64 throttled_time = 0;
+		int nr_throttled = 0;
+
+		/* autogroups share the root's rt_rqs */
+		if (task_group_is_autogroup(tg) || !sched_group_rt_runtime(tg))
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			struct rt_rq *rt_rq = tg->rt_rq[cpu];
+
+			nr_throttled += rt_rq->rt_nr_throttled;
+			throttled_time += rt_rq->rt_throttled_time;
+			if (rt_rq->rt_throttled)
+				throttled_time += rt_rq->rq->clock -
+					rt_rq->rt_throttled_timestamp;
+		}
+
+		cgroup_path(tg->css.cgroup, buf, 128);
+		printf("CGroup = %s (%d), rt_period = %ld us, "
+		       "rt_runtime = %ld us, nr_throttled = %d, "
+		       "throttled_time = %llu\n", buf, i,
+		       sched_group_rt_period(tg), sched_group_rt_runtime(tg),
+		       nr_throttled, throttled_time);
+	}
+}
+
 /* Create a normal task with the specified callback and
  * nice value of niceval, which determines its priority.
  */
@@ -337,9 +554,7 @@ struct task_struct *linsched_create_normal_task(struct task_data *td, int niceva
 {
 	struct sched_param params = {};
 	struct task_struct *p;
-	int id = num_tasks++;
-
-	assert(id < LINSCHED_MAX_TASKS);
+	int id = linsched_alloc_task_id();
 
 	/* Create "normal" task and set its nice value. */
 	p = __linsched_tasks[id] = __linsched_create_task(td);
@@ -360,11 +575,9 @@ struct task_struct *linsched_create_normal_task(struct task_data *td, int niceva
 struct task_struct *linsched_create_batch_task(struct task_data *td, int niceval)
 {
 	struct sched_param params = { };
-	int id = num_tasks++;
+	int id = linsched_alloc_task_id();
 	struct task_struct *p;
 
-	assert(id < LINSCHED_MAX_TASKS);
-
 	/* Create "batch" task and set its nice value. */
 	p = __linsched_tasks[id] = __linsched_create_task(td);
 	__linsched_set_task_id(p, id);
@@ -376,41 +589,37 @@ struct task_struct *linsched_create_batch_task(struct task_data *td, int niceval
 	return p;
 }
 
-/* Create a FIFO real-time task with the specified callback and priority. */
-struct task_struct *linsched_create_RTfifo_task(struct task_data *td, int prio)
+static struct task_struct *linsched_create_rt_task(struct task_data *td,
+						   int policy, int prio)
 {
 	struct sched_param params = { };
-	int id = num_tasks++;
+	int id = linsched_alloc_task_id();
 	struct task_struct *p;
 
-	assert(id < LINSCHED_MAX_TASKS);
-
-	/* Create FIFO real-time task and set its priority. */
 	p = __linsched_tasks[id] = __linsched_create_task(td);
 	__linsched_set_task_id(p, id);
 
+	/*
+	 * the task inherits the cgroup of whatever task is current, and
+	 * sched_setscheduler() refuses RT in a group without rt_runtime
+	 */
+	linsched_add_task_to_group(p, root_cgroup);
 	params.sched_priority = prio;
-	sched_setscheduler(p, SCHED_FIFO, &params);
+	sched_setscheduler(p, policy, &params);
 
 	return p;
 }
 
+/* Create a FIFO real-time task with the specified callback and priority. */
+struct task_struct *linsched_create_RTfifo_task(struct task_data *td, int prio)
+{
+	return linsched_create_rt_task(td, SCHED_FIFO, prio);
+}
+
 /* Create a RR real-time task with the specified callback and priority. */
 struct task_struct *linsched_create_RTrr_task(struct task_data *td, int prio)
 {
-	struct sched_param params = { };
-	int id = num_tasks++;
-	struct task_struct *p;
-
-	assert(id < LINSCHED_MAX_TASKS);
-
-	/* Create RR real-time task and set its priority. */
-	p = __linsched_tasks[id] = __linsched_create_task(td);
-
-	params.sched_priority = prio;
-	sched_setscheduler(p, SCHED_RR, &params);
-
-	return p;
+	return linsched_create_rt_task(td, SCHED_RR, prio);
 }
 
 void linsched_yield(void)
@@ -438,21 +647,21 @@ static enum hrtimer_restart wake_task(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
-static void sleep_run_init(struct sleep_run_data *d)
+void sleep_run_init(struct sleep_run_data *d)
 {
 	d->last_start = 0;
 	hrtimer_init(&d->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	d->timer.function = wake_task;
 }
 
-static void sleep_run_start(struct task_struct *p, void *data)
+void sleep_run_start(struct task_struct *p, void *data)
 {
 	struct sleep_run_data *d = data;
 	d->p = p;
 }
 
 /* Go to sleep in the given state and schedule a wakeup in ns nanoseconds */
-static void sleep_run_sleep_for(struct sleep_run_data *d, int state, u64 ns)
+void sleep_run_sleep_for(struct sleep_run_data *d, int state, u64 ns)
 {
 	hrtimer_set_expires(&d->timer, ns_to_ktime(ns));
 	hrtimer_start_expires(&d->timer, HRTIMER_MODE_REL);
@@ -466,7 +675,7 @@ static void sleep_run_sleep_for(struct sleep_run_data *d, int state, u64 ns)
 /* Start or continue a run for ns nanoseconds. Tries to schedule a
  * timer to end the run at the exact correct time. Returns true when
  * the run has been finished. */
-static int sleep_run_run_for(struct sleep_run_data *d, u64 ns)
+int sleep_run_run_for(struct sleep_run_data *d, u64 ns)
 {
 	struct task_struct *p = d->p;
 	/*
@@ -478,11 +687,10 @@ static int sleep_run_run_for(struct sleep_run_data *d, u64 ns)
 	if(p) {
 		runtime += task_exec_time(p);
 		if(p->on_rq) {
-			/* this isn't quite the "right" clock, but is the best
-			 * we can do without calling into the scheduler to
-			 * update rq->clock_task (which should be the same
-			 * anyway in linsched land) */
-			runtime += current_time - p->se.exec_start;
+			/* rq->clock_task as of now, which falls behind
+			 * current_time by the irq time of the cpu */
+			runtime += linsched_rq_clock_task(task_cpu(p)) -
+				   p->se.exec_start;
 		}
 	}
 
@@ -615,6 +823,9 @@ struct task_data *linsched_create_rnd_dist_sleep_run(struct rand_dist
 static void perf_task_handle(struct task_struct *p, void *data)
 {
 	struct perf_task *d = data;
+
+	if (d->io_req && !linsched_io_done(d->io_req))
+		return;
 	if (sleep_run_run_for(&d->sr_data, d->busy)) {
 		struct linsched_perf_event pe = perf_get_next_event(d->fp);
 		if (pe.duration) {
@@ -631,7 +842,12 @@ static void perf_task_handle(struct task_struct *p, void *data)
 			d->sleep = UINT_MAX;
 			d->busy = 0;
 		}
-		if (d->sleep) {
+		/* the recorded wait becomes the service time of the
+		 * request, queueing on the device comes on top */
+		if (d->sleep && pe.type == IOWAIT && d->io_dev && p) {
+			hrtimer_try_to_cancel(&d->sr_data.timer);
+			linsched_io_wait(d->io_dev, d->io_req, p, d->sleep);
+		} else if (d->sleep) {
 			int state;
 			if (pe.type == SLEEP)
 				state = TASK_INTERRUPTIBLE;	/* sleep */
@@ -642,13 +858,19 @@ static void perf_task_handle(struct task_struct *p, void *data)
 	}
 }
 
-struct task_data *linsched_create_perf_task(char *filename)
+struct task_data *linsched_create_perf_task(char *filename,
+					    struct linsched_io_dev *io_dev)
 {
 	struct task_data *td = malloc(sizeof(struct task_data));
 	struct perf_task *d =  malloc(sizeof(struct perf_task));
 
 	memset(d, 0, sizeof(*d));
 	sleep_run_init(&d->sr_data);
+	if (io_dev) {
+		d->io_dev = io_dev;
+		d->io_req = malloc(sizeof(struct linsched_io_req));
+		linsched_io_init_req(d->io_req);
+	}
 
 	d->fp = fopen(filename, "r");
 	if (d->fp) {
@@ -658,6 +880,7 @@ struct task_data *linsched_create_perf_task(char *filename)
 		fprintf(stderr, "\nopening %s failed. Error : %s",
 				filename, strerror(errno));
 		free(td);
+		free(d->io_req);
 		free(d);
 		return NULL;
 	}
@@ -670,9 +893,11 @@ struct task_data *linsched_create_perf_task(char *filename)
 
 /* creates perf tasks for rlogs in directory
  * @_dirpath: path to directory
+ * @io_dev: device the IOWAIT events of the tasks wait for, or NULL
+ * to replay them as fixed sleeps
  * returns 0 on success, negative on failure
  */
-int linsched_create_perf_tasks(char *_dirpath)
+int linsched_create_perf_tasks(char *_dirpath, struct linsched_io_dev *io_dev)
 {
 	DIR *dir;
 	struct dirent *de;
@@ -693,7 +918,8 @@ int linsched_create_perf_tasks(char *_dirpath)
 			filepath = strcpy(filepath, dirpath);
 			strcat(filepath, de->d_name);
 			if (strstr(de->d_name, ".rlog")) {
-				td = linsched_create_perf_task(filepath);
+				td = linsched_create_perf_task(filepath,
+							       io_dev);
 				if (td)
 					linsched_create_normal_task(td, 0);
 			}
@@ -730,6 +956,16 @@ void sched_set_stop_task(int cpu, struct task_struct *stop);
 static enum hrtimer_restart wake_stop(struct hrtimer *timer)
 {
 	struct stop_task *d = container_of(timer, struct stop_task, timer);
+
+	/*
+	 * the timer migrates with the rest when its cpu goes down; drop
+	 * the work as cpu_stop_cpu_callback() does, waking the stopper
+	 * would move it off its cpu
+	 */
+	if (!cpu_online(task_cpu(d->p))) {
+		d->fxn = NULL;
+		return HRTIMER_NORESTART;
+	}
 	wake_up_process(d->p);
 	return HRTIMER_NORESTART;
 }
@@ -46,6 +46,7 @@ static u64 last_time;
 static u64 start_time;
 
 static double total_imbalance;
+static double last_imbalance;
 
 static int cpu_load_compare(const struct lb_cpu *a, const struct lb_cpu *b);
 static int task_compare(const struct lb_task *a, const struct lb_task *b);
@@ -160,6 +161,7 @@ void init_lb_info(void)
 {
 	start_time = 0;
 	total_imbalance = 0;
+	last_imbalance = 0;
 }
 
 hash_t mixhash(hash_t hash, uintptr_t value) {
@@ -168,6 +170,16 @@ hash_t mixhash(hash_t hash, uintptr_t value) {
 	return hash * 29 + value;
 }
 
+/* throttled groups stay queued, but nothing below them can run */
+static int lb_throttled(struct cfs_rq *cfs_rq)
+{
+#ifdef CONFIG_CFS_BANDWIDTH
+	return cfs_rq->throttle_count;
+#else
+	return 0;
+#endif
+}
+
 static hash_t setup_lb_info(void)
 {
 	int i, out, cpu;
@@ -179,7 +191,7 @@ static hash_t setup_lb_info(void)
 	for(i = 1; i < num_tasks; i++) {
 		int j;
 		p = __linsched_tasks[i];
-		if (!p->se.on_rq)
+		if (!p || !p->se.on_rq || lb_throttled(p->se.cfs_rq))
 			continue;
 		lb_tasks[out].p = p;
 		lb_tasks[out].cpus_allowed = cpumask_weight(&p->cpus_allowed);
@@ -204,7 +216,8 @@ static hash_t setup_lb_info(void)
 			continue;
 		if (tg != &root_task_group) {
 			for_each_online_cpu(cpu) {
-				if (tg->se[cpu]->on_rq) {
+				if (tg->se[cpu]->on_rq &&
+				    !lb_throttled(tg->se[cpu]->cfs_rq)) {
 					on_rq = 1;
 					break;
 				}
@@ -286,6 +299,7 @@ void compute_lb_info(void)
 	}
 
 	total_imbalance += imbalance * (current_time - old_time);
+	last_imbalance = imbalance;
 
 	if (linsched_global_options.dump_imbalance) {
 		printf("imbalance at %llu: %f\n",
@@ -296,11 +310,23 @@ void compute_lb_info(void)
 	}
 }
 
+/* the imbalance computed at the last event */
+double get_current_imbalance(void)
+{
+	return last_imbalance;
+}
+
 double get_average_imbalance(void)
 {
 	return total_imbalance / (current_time - start_time);
 }
 
+/* the imbalance integrated over time so far, in imbalance * ns */
+double get_total_imbalance(void)
+{
+	return total_imbalance;
+}
+
 void dump_lb_info(FILE *out)
 {
 	int i;
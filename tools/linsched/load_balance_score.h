@@ -5,7 +5,9 @@
 
 void init_lb_info(void);
 void compute_lb_info(void);
+double get_current_imbalance(void);
 double get_average_imbalance(void);
+double get_total_imbalance(void);
 void dump_lb_info(FILE *out);
 
 #endif
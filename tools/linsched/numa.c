@@ -27,6 +27,7 @@
 #include <linux/hrtimer.h>
 
 #include "linsched.h"
+#include <stdio.h>
 
 int nr_node_ids;
 int nr_cpu_ids;
@@ -91,16 +92,131 @@ const struct cpumask *get_cpu_core_mask(int cpu)
 	return cpu_core_masks[cpu_to_core_map[cpu]];
 }
 
+/*
+ * IPIs are instantaneous unless --ipi_latency is given: then an IPI
+ * reaches a cpu that shares a core with the sender after
+ * ipi_latency[IPI_SMT] ns, and so on out to other nodes, whose latency
+ * is ipi_latency[IPI_NODE] scaled by node_distance() / LOCAL_DISTANCE.
+ * An IPI sent while another is in flight to the same cpu merges with
+ * it, like a pending reschedule vector. --ipi_cost charges the handler
+ * time of every IPI to the target as hardirq time.
+ */
+static u64 ipi_latency[IPI_NR_DISTANCES];
+static u64 ipi_cost;
+static int ipi_model;
+static u64 ipi_sent[IPI_NR_DISTANCES], ipi_merged[IPI_NR_DISTANCES];
+static u64 ipi_delay_sum[IPI_NR_DISTANCES], ipi_delivered;
+static const char *ipi_distance_names[IPI_NR_DISTANCES] = {
+	"smt", "llc", "node", "remote"
+};
+
+/* parses "<smt ns>,<llc ns>,<node ns>" for --ipi_latency */
+int linsched_set_ipi_latency(const char *arg)
+{
+	unsigned long long smt, llc, node;
+	char end;
+
+	if (sscanf(arg, "%llu,%llu,%llu%c", &smt, &llc, &node, &end) != 3 ||
+	    !smt || !llc || !node)
+		return -EINVAL;
+	ipi_latency[IPI_SMT] = smt;
+	ipi_latency[IPI_LLC] = llc;
+	ipi_latency[IPI_NODE] = ipi_latency[IPI_REMOTE] = node;
+	ipi_model = 1;
+	return 0;
+}
+
+void linsched_set_ipi_cost(u64 ns)
+{
+	ipi_cost = ns;
+	if (ns)
+		enable_sched_clock_irqtime();
+}
+
+static int ipi_distance(int from, int to)
+{
+	if (cpumask_test_cpu(to, get_cpu_core_mask(from)))
+		return IPI_SMT;
+	if (cpumask_test_cpu(to, cpu_coregroup_mask(from)))
+		return IPI_LLC;
+	if (cpu_to_node(to) == cpu_to_node(from))
+		return IPI_NODE;
+	return IPI_REMOTE;
+}
+
+static u64 ipi_delay(int from, int to, int distance)
+{
+	if (distance == IPI_REMOTE)
+		return ipi_latency[IPI_REMOTE] *
+			node_distances[cpu_to_node(from)][cpu_to_node(to)] /
+			LOCAL_DISTANCE;
+	return ipi_latency[distance];
+}
+
 static enum hrtimer_restart cpu_triggered(struct hrtimer *t)
 {
+	if (ipi_cost)
+		linsched_account_irq_time(smp_processor_id(), ipi_cost, 0);
+	ipi_delivered++;
 	scheduler_ipi();
 	return HRTIMER_NORESTART;
 }
 
+/* the IPI lands on cpu, which is current, after the modelled latency */
+static void trigger_cpu_delayed(int from, int cpu)
+{
+	int distance = ipi_distance(from, cpu);
+	u64 delay = ipi_delay(from, cpu, distance);
+
+	ipi_sent[distance]++;
+	if (hrtimer_active(&trigger_timer[cpu])) {
+		ipi_merged[distance]++;
+		return;
+	}
+	ipi_delay_sum[distance] += delay;
+	hrtimer_init(&trigger_timer[cpu], CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	trigger_timer[cpu].function = cpu_triggered;
+	hrtimer_start(&trigger_timer[cpu], ns_to_ktime(delay),
+		      HRTIMER_MODE_REL_PINNED);
+	linsched_program_cpu_event(cpu, current_time + delay);
+}
+
+/* the latency of an IPI from this cpu to cpu, 0 when instantaneous */
+u64 linsched_ipi_delay(int cpu)
+{
+	int this_cpu = smp_processor_id();
+
+	if (!ipi_model || cpu == this_cpu)
+		return 0;
+	return ipi_delay(this_cpu, cpu, ipi_distance(this_cpu, cpu));
+}
+
+void linsched_print_ipi_stats(void)
+{
+	int i;
+
+	printf("%-8s %10s %10s %12s\n", "distance", "sent", "merged",
+	       "latency_us");
+	for (i = 0; i < IPI_NR_DISTANCES; i++) {
+		u64 n = ipi_sent[i] - ipi_merged[i];
+
+		printf("%-8s %10llu %10llu %12.2f\n", ipi_distance_names[i],
+		       ipi_sent[i], ipi_merged[i],
+		       n ? ipi_delay_sum[i] / 1000.0 / n : 0);
+	}
+	printf("delivered = %llu, cost = %llu ns each\n", ipi_delivered,
+	       ipi_cost);
+}
+
 void linsched_trigger_cpu(int cpu)
 {
 	int curr_cpu = smp_processor_id();
 	linsched_change_cpu(cpu);
+	if (ipi_model && cpu != curr_cpu) {
+		trigger_cpu_delayed(curr_cpu, cpu);
+		linsched_change_cpu(curr_cpu);
+		return;
+	}
 	if (!hrtimer_active(&trigger_timer[cpu])) {
 		hrtimer_init(&trigger_timer[cpu], CLOCK_MONOTONIC,
 			     HRTIMER_MODE_REL);
@@ -110,9 +226,13 @@ void linsched_trigger_cpu(int cpu)
 			      HRTIMER_MODE_REL);
 	}
 	/*
-	 * Call the scheduler ipi when queueing up tasks on the wakelist
+	 * Call the scheduler ipi when queueing up tasks on the wakelist,
+	 * unless the sender holds the target's rq lock (e.g. resched_task()
+	 * from a wakeup); a real ipi would wait for it, and trigger_timer
+	 * delivers it.
 	 */
-	scheduler_ipi();
+	if (!raw_spin_is_locked(&cpu_rq(cpu)->lock))
+		scheduler_ipi();
 	if (need_resched())
 		cpumask_set_cpu(cpu, &linsched_cpu_resched_pending);
 	linsched_change_cpu(curr_cpu);
@@ -140,5 +260,16 @@ void linsched_offline_cpu(int cpu)
 
 void linsched_online_cpu(int cpu)
 {
-	cpu_up(cpu);
+	int old_cpu = smp_processor_id();
+
+	if (cpu_up(cpu))
+		return;
+	/*
+	 * the clock event device was released when the cpu went down, set
+	 * it up and switch to high resolution again, as at boot
+	 */
+	linsched_change_cpu(cpu);
+	linsched_init_clockevent();
+	hrtimer_run_pending();
+	linsched_change_cpu(old_cpu);
 }
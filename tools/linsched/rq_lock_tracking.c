@@ -0,0 +1,147 @@
+/* Tracking rq->lock contention
+ *
+ * linsched runs one cpu at a time, so no lock is ever contended. This
+ * notes which cpu takes which rq->lock at which simulated time, and
+ * takes every acquisition to hold the lock for a critical section of
+ * rq_lock_window ns. A cpu that takes a lock another cpu still holds
+ * waits for it, and so do the locks it takes after that; the wait is
+ * charged as irq time to the waiting cpu, which takes it away from
+ * the task running there, as spinning with interrupts off would.
+ *
+ * Acquisitions are charged to the code path that made them (see
+ * RQ_LOCK_* in kernel/sched/sched.h), which shows e.g. how much of
+ * the contention comes from nohz_idle_balance() or update_shares()
+ * walking the runqueues of other cpus.
+ */
+
+#include "linsched.h"
+#include "rq_lock_tracking.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct rq_lock_data {
+	int holder;
+	u64 free_at;
+
+	/* stats */
+	u64 acquired, remote, contended, wait_time, max_wait;
+};
+
+struct rq_lock_site_data {
+	u64 acquired, remote, contended, wait_time;
+};
+
+void (*linsched_spin_lock_hook)(arch_spinlock_t *lock);
+int linsched_rq_lock_site;
+
+static u64 rq_lock_window;
+static unsigned long rq_lock_base, rq_lock_stride;
+static struct rq_lock_data rq_locks[NR_CPUS];
+static struct rq_lock_site_data rq_lock_sites[NR_RQ_LOCK_SITES];
+static u64 cpu_clock_at[NR_CPUS];	/* when the cpu is done locking */
+static u64 cpu_spin_time[NR_CPUS];
+
+static const char *rq_lock_site_names[NR_RQ_LOCK_SITES] = {
+	"other", "ttwu", "double_rq_lock", "load_balance",
+	"nohz_balance", "update_shares"
+};
+
+int set_rq_lock_window(const char *arg)
+{
+	char *end;
+
+	rq_lock_window = strtoull(arg, &end, 0);
+	if (*end || !rq_lock_window)
+		return -1;
+	return 0;
+}
+
+static void rq_lock_acquired(arch_spinlock_t *lock)
+{
+	unsigned long off = (unsigned long)lock - rq_lock_base;
+	int cpu = smp_processor_id(), rq_cpu;
+	struct rq_lock_data *d;
+	struct rq_lock_site_data *s = &rq_lock_sites[linsched_rq_lock_site];
+	u64 now = max(current_time, cpu_clock_at[cpu]);
+
+	/* the runqueues are per cpu, so their locks are stride apart */
+	if (off % rq_lock_stride || off / rq_lock_stride >= nr_cpu_ids)
+		return;
+	rq_cpu = off / rq_lock_stride;
+	d = &rq_locks[rq_cpu];
+
+	d->acquired++;
+	s->acquired++;
+	if (rq_cpu != cpu) {
+		d->remote++;
+		s->remote++;
+	}
+	if (d->holder != cpu && now < d->free_at) {
+		u64 wait = d->free_at - now;
+
+		d->contended++;
+		d->wait_time += wait;
+		d->max_wait = max(d->max_wait, wait);
+		s->contended++;
+		s->wait_time += wait;
+		cpu_spin_time[cpu] += wait;
+		linsched_account_irq_time(cpu, wait, 0);
+		now = d->free_at;
+	}
+	d->holder = cpu;
+	d->free_at = now + rq_lock_window;
+	cpu_clock_at[cpu] = d->free_at;
+}
+
+void start_rq_lock_tracking(void)
+{
+	int cpu;
+
+	if (!rq_lock_window || linsched_spin_lock_hook)
+		return;
+
+	rq_lock_base = (unsigned long)&cpu_rq(0)->lock.raw_lock;
+	rq_lock_stride = 1;
+	if (nr_cpu_ids > 1)
+		rq_lock_stride = (unsigned long)&cpu_rq(1)->lock.raw_lock -
+			rq_lock_base;
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		BUG_ON((unsigned long)&cpu_rq(cpu)->lock.raw_lock !=
+		       rq_lock_base + cpu * rq_lock_stride);
+		rq_locks[cpu].holder = -1;
+	}
+	enable_sched_clock_irqtime();
+	linsched_spin_lock_hook = rq_lock_acquired;
+}
+
+void print_rq_lock_stats(void)
+{
+	int cpu, i;
+
+	if (!rq_lock_window) {
+		printf("not tracked, see --rq_lock_window\n");
+		return;
+	}
+
+	printf("window = %llu ns\n", rq_lock_window);
+	printf("%4s %10s %10s %10s %10s %11s %10s\n", "rq", "acquired",
+	       "remote", "contended", "wait_us", "max_wait_us", "spin_us");
+	for_each_online_cpu(cpu) {
+		struct rq_lock_data *d = &rq_locks[cpu];
+
+		printf("%4d %10llu %10llu %10llu %10.1f %11.2f %10.1f\n", cpu,
+		       d->acquired, d->remote, d->contended,
+		       d->wait_time / 1000.0, d->max_wait / 1000.0,
+		       cpu_spin_time[cpu] / 1000.0);
+	}
+
+	printf("%-15s %10s %10s %10s %10s\n", "site", "acquired", "remote",
+	       "contended", "wait_us");
+	for (i = 0; i < NR_RQ_LOCK_SITES; i++) {
+		struct rq_lock_site_data *s = &rq_lock_sites[i];
+
+		printf("%-15s %10llu %10llu %10llu %10.1f\n",
+		       rq_lock_site_names[i], s->acquired, s->remote,
+		       s->contended, s->wait_time / 1000.0);
+	}
+}
@@ -0,0 +1,9 @@
+#ifndef RQ_LOCK_TRACKING_H
+#define RQ_LOCK_TRACKING_H
+
+int set_rq_lock_window(const char *arg);
+/* called as linsched_run_sim() starts, after the test's setup */
+void start_rq_lock_tracking(void);
+void print_rq_lock_stats(void);
+
+#endif
@@ -2,8 +2,74 @@
 #include "linsched.h"
 #include "sanity_check.h"
 
+#include <stdio.h>
+
+/* <time.h> conflicts with the kernel headers */
+int clock_gettime(clockid_t clk_id, struct timespec *tp);
+
+int sanity_check_level = SANITY_CHECK_LOCAL;
+int sanity_check_interval = 64;
+
+static const char *level_names[] = {
+	[SANITY_CHECK_OFF] = "off",
+	[SANITY_CHECK_SAMPLED] = "sampled",
+	[SANITY_CHECK_LOCAL] = "local",
+	[SANITY_CHECK_GLOBAL] = "global",
+};
+
+enum {
+	CHECK_RQ,		/* entities, counts and load of one rq */
+	CHECK_CPU_LOAD,		/* rq->cpu_load[] of every rq */
+	CHECK_TASK_GROUPS,	/* tg->load_weight of every task group */
+	NR_CHECKS
+};
+
+static const char *check_names[NR_CHECKS] = {
+	"rq", "cpu_load", "task_groups",
+};
+
+static struct {
+	u64 calls;
+	u64 ns;
+} check_stats[NR_CHECKS];
+static u64 nr_events, nr_checked;
+
+static u64 host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void account_check(int check, u64 start)
+{
+	check_stats[check].calls++;
+	check_stats[check].ns += host_ns() - start;
+}
+
 static unsigned long check_cfs_rq(struct cfs_rq *cfs_rq);
 
+/* min_vruntime of every group's cfs_rq on every cpu when last checked */
+static u64 last_min_vruntime[LINSCHED_MAX_GROUPS][NR_CPUS];
+static DECLARE_BITMAP(min_vruntime_seen, LINSCHED_MAX_GROUPS * NR_CPUS);
+
+/* min_vruntime only ever moves forward */
+static void check_min_vruntime(struct cfs_rq *cfs_rq)
+{
+	int cpu = cpu_of(cfs_rq->rq), id;
+
+	if (!cfs_rq->tg->css.cgroup)
+		return;
+	id = linsched_tg(cfs_rq->tg) - __linsched_cgroups;
+	if (id < 0 || id >= LINSCHED_MAX_GROUPS)
+		return;
+	if (test_and_set_bit(id * NR_CPUS + cpu, min_vruntime_seen))
+		BUG_ON((s64)(cfs_rq->min_vruntime -
+			     last_min_vruntime[id][cpu]) < 0);
+	last_min_vruntime[id][cpu] = cfs_rq->min_vruntime;
+}
+
 static unsigned long check_cfs_se(struct sched_entity *se, struct cfs_rq *cfs_rq)
 {
 	BUG_ON(se->cfs_rq != cfs_rq);
@@ -12,11 +78,12 @@ static unsigned long check_cfs_se(struct sched_entity *se, struct cfs_rq *cfs_rq
 	if (se->my_q) {
 		unsigned long tasks = check_cfs_rq(se->my_q);
 		BUG_ON(!tasks);
+		/* a group is never queued without weight, see calc_cfs_shares() */
+		BUG_ON(se->load.weight < MIN_SHARES);
 		return tasks;
 	} else {
 		struct task_struct *p = container_of(se, struct task_struct, se);
 		BUG_ON(cpu_rq(task_cpu(p)) != cfs_rq->rq);
-		BUG_ON(task_cpu(p) != debug_smp_processor_id());
 	}
 	return 1;
 }
@@ -29,7 +96,10 @@ static unsigned long check_cfs_rq(struct cfs_rq *cfs_rq)
 	unsigned long load = 0;
 	struct rb_node *node, *first;
 
-	if (cfs_rq->curr) {
+	if (cfs_rq->curr && !cfs_rq->curr->on_rq) {
+		/* dequeued, e.g. throttled, and about to be put */
+		BUG_ON(!test_tsk_need_resched(cfs_rq->rq->curr));
+	} else if (cfs_rq->curr) {
 		h_nr_running += check_cfs_se(cfs_rq->curr, cfs_rq);
 		nr_running++;
 		load += cfs_rq->curr->load.weight;
@@ -52,6 +122,9 @@ static unsigned long check_cfs_rq(struct cfs_rq *cfs_rq)
 	}
 	BUG_ON(load != cfs_rq->load.weight);
 	BUG_ON(nr_running != cfs_rq->nr_running);
+	/* throttled children are dequeued along with their tasks */
+	BUG_ON(h_nr_running != cfs_rq->h_nr_running);
+	check_min_vruntime(cfs_rq);
 
 	return h_nr_running;
 }
@@ -61,7 +134,7 @@ static unsigned long check_rt_rq(struct rt_rq *rt_rq);
 static unsigned long check_rt_se(struct sched_rt_entity *rt_se, struct rt_rq *rt_rq)
 {
 #ifdef CONFIG_RT_GROUP_SCHED
-	BUG_ON(rt_se->parent != rt_rq);
+	BUG_ON(rt_se->rt_rq != rt_rq);
 	if (rt_se->my_q) {
 		unsigned long tasks = check_rt_rq(rt_se->my_q);;
 		BUG_ON(!tasks);
@@ -78,8 +151,8 @@ static unsigned long check_rt_rq(struct rt_rq *rt_rq)
 	struct rt_prio_array *array = &rt_rq->active;
 	int idx = -1;
 
-	while((idx = find_next_bit(array->bitmap, MAX_RT_PRIO, idx+1) <
-	       MAX_RT_PRIO)) {
+	while((idx = find_next_bit(array->bitmap, MAX_RT_PRIO, idx+1)) <
+	      MAX_RT_PRIO) {
 		struct sched_rt_entity *rt_se;
 		list_for_each_entry(rt_se, &array->queue[idx], run_list) {
 			h_nr_running += check_rt_se(rt_se, rt_rq);
@@ -87,10 +160,38 @@ static unsigned long check_rt_rq(struct rt_rq *rt_rq)
 		}
 	}
 
+	/* a priority's bit is set iff its queue is not empty */
+	for (idx = 0; idx < MAX_RT_PRIO; idx++)
+		BUG_ON((!test_bit(idx, array->bitmap)) !=
+		       list_empty(&array->queue[idx]));
+#if defined CONFIG_SMP || defined CONFIG_RT_GROUP_SCHED
+	idx = sched_find_first_bit(array->bitmap);
+	BUG_ON(rt_rq->highest_prio.curr != min(idx, MAX_RT_PRIO));
+#endif
 	BUG_ON(rt_rq->rt_nr_running != nr_running);
 	return h_nr_running;
 }
 
+#ifdef CONFIG_RT_GROUP_SCHED
+/* throttled groups are dequeued from their parent, but their tasks
+ * still count in rq->nr_running */
+static unsigned long check_throttled_rt_rqs(struct rq *rq)
+{
+	unsigned long nr_running = 0;
+	struct rt_rq *rt_rq;
+
+	list_for_each_entry(rt_rq, &rq->leaf_rt_rq_list, leaf_rt_rq_list) {
+		struct sched_rt_entity *rt_se = rt_rq->tg->rt_se[cpu_of(rq)];
+
+		if (rt_se && list_empty(&rt_se->run_list)) {
+			BUG_ON(!rt_rq->rt_throttled);
+			nr_running += check_rt_rq(rt_rq);
+		}
+	}
+	return nr_running;
+}
+#endif
+
 static void check_rq(struct rq *rq)
 {
 	unsigned long nr_running = 0;
@@ -98,18 +199,120 @@ static void check_rq(struct rq *rq)
 	if (rq->stop->on_rq) /* stop_sched_class */
 		nr_running++;
 	nr_running += check_rt_rq(&rq->rt); /* rt_sched_class */
+#ifdef CONFIG_RT_GROUP_SCHED
+	nr_running += check_throttled_rt_rqs(rq);
+#endif
 	nr_running += check_cfs_rq(&rq->cfs); /* fair_sched_class */
 
 	/* idle doesn't contribute to nr_running, so it isn't here */
 	BUG_ON(nr_running != rq->nr_running);
+	/* only top level cfs entities add to the rq's load */
+	BUG_ON(rq->load.weight != rq->cfs.load.weight);
 }
 
-void run_sanity_check(void)
+/*
+ * every cpu_load[i] is an average of the loads cpu_load[0] took at
+ * the updates, rounded up, so it never exceeds the largest of them;
+ * that is only seen when every rq is checked after every event
+ */
+static void check_cpu_load(void)
 {
-	/*
-	 * only bother checking one cpu at a time, any other cpus
-	 * affected by the current tick will get checked whenever they
-	 * run, which will likely be soon enough
-	 */
-	check_rq(cpu_rq(debug_smp_processor_id()));
+	static unsigned long peak_load[NR_CPUS];
+	u64 start = host_ns();
+	int cpu, i;
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		peak_load[cpu] = max(peak_load[cpu], rq->cpu_load[0]);
+		for (i = 1; i < CPU_LOAD_IDX_MAX; i++)
+			BUG_ON(rq->cpu_load[i] > peak_load[cpu]);
+	}
+	account_check(CHECK_CPU_LOAD, start);
+}
+
+/* tg->load_weight is the sum of what its cfs_rqs contributed */
+static void check_task_groups(void)
+{
+#if defined(CONFIG_FAIR_GROUP_SCHED) && defined(CONFIG_SMP)
+	struct task_group *tg;
+	u64 start = host_ns();
+	int cpu;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(tg, &task_groups, list) {
+		long load = 0;
+
+		if (tg == &root_task_group)
+			continue;
+		for_each_possible_cpu(cpu)
+			load += tg->cfs_rq[cpu]->load_contribution;
+		BUG_ON(load != atomic_read(&tg->load_weight));
+	}
+	rcu_read_unlock();
+	account_check(CHECK_TASK_GROUPS, start);
+#endif
+}
+
+void __run_sanity_check(void)
+{
+	u64 start;
+	int cpu;
+
+	nr_events++;
+	switch (sanity_check_level) {
+	case SANITY_CHECK_SAMPLED:
+		if (nr_events % sanity_check_interval)
+			return;
+		/* fall through */
+	case SANITY_CHECK_LOCAL:
+		/*
+		 * only bother checking one cpu at a time, any other cpus
+		 * affected by the current tick will get checked whenever
+		 * they run, which will likely be soon enough
+		 */
+		start = host_ns();
+		check_rq(cpu_rq(debug_smp_processor_id()));
+		account_check(CHECK_RQ, start);
+		break;
+	case SANITY_CHECK_GLOBAL:
+		start = host_ns();
+		for_each_online_cpu(cpu)
+			check_rq(cpu_rq(cpu));
+		account_check(CHECK_RQ, start);
+		check_cpu_load();
+		check_task_groups();
+		break;
+	}
+	nr_checked++;
+}
+
+int set_sanity_check_level(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(level_names); i++) {
+		if (!strcmp(name, level_names[i])) {
+			sanity_check_level = i;
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+void print_sanity_check_stats(void)
+{
+	int i;
+
+	printf("level: %s, events: %llu, checked: %llu\n",
+	       level_names[sanity_check_level], nr_events, nr_checked);
+	printf("%-12s %12s %12s %10s\n", "check", "calls", "total ms",
+	       "ns/call");
+	for (i = 0; i < NR_CHECKS; i++) {
+		if (!check_stats[i].calls)
+			continue;
+		printf("%-12s %12llu %12.3f %10llu\n", check_names[i],
+		       check_stats[i].calls, check_stats[i].ns / 1e6,
+		       check_stats[i].ns / check_stats[i].calls);
+	}
 }
@@ -1,6 +1,25 @@
 #ifndef SANITY_CHECK_H
 #define SANITY_CHECK_H
 
-void run_sanity_check(void);
+enum {
+	SANITY_CHECK_OFF,
+	SANITY_CHECK_SAMPLED,	/* this cpu's rq, every sanity_check_interval */
+	SANITY_CHECK_LOCAL,	/* this cpu's rq, every event */
+	SANITY_CHECK_GLOBAL,	/* every rq and task group, every event */
+};
+
+extern int sanity_check_level;
+extern int sanity_check_interval;
+
+void __run_sanity_check(void);
+int set_sanity_check_level(const char *name);
+void print_sanity_check_stats(void);
+
+/* called after every event; costs a test when checks are off */
+static inline void run_sanity_check(void)
+{
+	if (sanity_check_level)
+		__run_sanity_check();
+}
 
 #endif
@@ -0,0 +1,187 @@
+/* Profiling the simulator
+ *
+ * With --profile_sim, the host cycles (rdtsc, see getticks()) spent
+ * in linsched_run_sim() are charged to the phase of the event loop
+ * they were spent in, so that we know where the wall time of a
+ * simulation goes, and how fast it simulates. There are about a dozen
+ * timestamps per event, of a few tens of cycles each, which is a
+ * quarter of the time of a cheap event; so only one event in
+ * --profile_sim_interval is timed, which keeps the overhead to a few
+ * percent and the profile on in benchmark runs. Events per second and
+ * simulated time per wall second are measured over every event; the
+ * report estimates the overhead.
+ */
+
+#include "linsched.h"
+#include "sim_profile.h"
+#include <stdio.h>
+
+/* <time.h> conflicts with the kernel headers */
+int clock_gettime(clockid_t clk_id, struct timespec *tp);
+
+#define MAX_DEPTH 16
+
+static const char *phase_names[NR_SIM_PHASES] = {
+	[PHASE_OTHER] = "other",
+	[PHASE_EVENT_HANDLER] = "event_handler",
+	[PHASE_SOFTIRQ_SCHED] = "softirq_sched",
+	[PHASE_SOFTIRQ_HRTIMER] = "softirq_hrtimer",
+	[PHASE_RCU] = "rcu",
+	[PHASE_SCENARIO] = "scenario",
+	[PHASE_RESCHED] = "resched",
+	[PHASE_TASKS] = "tasks",
+	[PHASE_LB_INFO] = "lb_info",
+	[PHASE_NOHZ] = "nohz",
+	[PHASE_SANITY] = "sanity",
+};
+
+int sim_profile_active;
+int sim_profile_interval = 8;
+static int profiling;
+
+static int phase_stack[MAX_DEPTH];
+static int depth;
+static u64 last_stamp;
+static u64 phase_cycles[NR_SIM_PHASES];
+static u64 phase_calls[NR_SIM_PHASES];
+static u64 nr_stamps, nr_events, nr_sampled;
+
+/* totals over every linsched_run_sim() */
+static u64 start_cycles, total_cycles;
+static u64 start_ns, total_ns;
+static u64 start_time, total_sim_ns;
+static double stamp_cycles;
+
+static u64 host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+void __sim_profile_enter(int phase)
+{
+	u64 now = getticks();
+
+	BUG_ON(depth == MAX_DEPTH - 1);
+	phase_cycles[phase_stack[depth]] += now - last_stamp;
+	phase_stack[++depth] = phase;
+	phase_calls[phase]++;
+	nr_stamps++;
+	last_stamp = now;
+}
+
+void __sim_profile_exit(void)
+{
+	u64 now = getticks();
+
+	BUG_ON(!depth);
+	phase_cycles[phase_stack[depth--]] += now - last_stamp;
+	nr_stamps++;
+	last_stamp = now;
+}
+
+/* called between events, outside of any phase */
+void sim_profile_event(void)
+{
+	int sample;
+	u64 now;
+
+	if (!profiling)
+		return;
+
+	nr_events++;
+	sample = !(nr_events % sim_profile_interval);
+	if (sample == sim_profile_active) {
+		nr_sampled += sample;
+		return;
+	}
+
+	now = getticks();
+	nr_stamps++;
+	if (sim_profile_active) {
+		phase_cycles[PHASE_OTHER] += now - last_stamp;
+	} else {
+		nr_sampled++;
+		last_stamp = now;
+	}
+	sim_profile_active = sample;
+}
+
+void sim_profile_start(void)
+{
+	int i;
+
+	if (!linsched_global_options.profile_sim)
+		return;
+
+	/* the cost of a timestamp, for the overhead estimate */
+	if (!stamp_cycles) {
+		u64 t0 = getticks();
+
+		for (i = 0; i < 1000; i++)
+			getticks();
+		stamp_cycles = (getticks() - t0) / 1001.0;
+	}
+	depth = 0;
+	phase_stack[0] = PHASE_OTHER;
+	start_time = current_time;
+	start_ns = host_ns();
+	start_cycles = last_stamp = getticks();
+	/* the initial task handlers, before the first event */
+	sim_profile_active = 1;
+	profiling = 1;
+}
+
+void sim_profile_stop(void)
+{
+	u64 now;
+
+	if (!profiling)
+		return;
+
+	now = getticks();
+	BUG_ON(depth);
+	if (sim_profile_active)
+		phase_cycles[PHASE_OTHER] += now - last_stamp;
+	total_cycles += now - start_cycles;
+	total_ns += host_ns() - start_ns;
+	total_sim_ns += current_time - start_time;
+	sim_profile_active = 0;
+	profiling = 0;
+}
+
+void print_sim_profile(void)
+{
+	double wall = total_ns / 1e9;
+	u64 sampled = 0;
+	int i;
+
+	for (i = 0; i < NR_SIM_PHASES; i++)
+		sampled += phase_cycles[i];
+	if (!total_cycles || !wall || !sampled)
+		return;
+
+	printf("events: %llu, simulated: %.3f s, wall: %.3f s, "
+	       "%.0f Mcycles/s\n", nr_events, total_sim_ns / 1e9, wall,
+	       total_cycles / wall / 1e6);
+	printf("events/s: %.0f, simulated s/wall s: %.3f\n",
+	       nr_events / wall, total_sim_ns / 1e9 / wall);
+	printf("sampled: %llu events (1 in %d), %.1f%% of the cycles\n",
+	       nr_sampled, sim_profile_interval,
+	       100.0 * sampled / total_cycles);
+	printf("%-16s %12s %14s %7s %13s\n", "phase", "calls", "cycles",
+	       "%", "cycles/event");
+	for (i = 0; i < NR_SIM_PHASES; i++) {
+		if (!phase_cycles[i])
+			continue;
+		printf("%-16s %12llu %14llu %6.2f%% %13.0f\n", phase_names[i],
+		       phase_calls[i], phase_cycles[i],
+		       100.0 * phase_cycles[i] / sampled,
+		       nr_sampled ? (double)phase_cycles[i] / nr_sampled : 0);
+	}
+	printf("profiling overhead: ~%.2f%% (%llu timestamps of ~%.0f "
+	       "cycles)\n", 100.0 * nr_stamps * stamp_cycles / total_cycles,
+	       nr_stamps, stamp_cycles);
+}
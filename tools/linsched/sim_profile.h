@@ -0,0 +1,47 @@
+#ifndef SIM_PROFILE_H
+#define SIM_PROFILE_H
+
+/* parts of linsched_run_sim() that host cycles are charged to */
+enum {
+	PHASE_OTHER,		/* the event loop, idle entry */
+	PHASE_EVENT_HANDLER,	/* ticks and hrtimer expiry */
+	PHASE_SOFTIRQ_SCHED,	/* run_rebalance_domains() */
+	PHASE_SOFTIRQ_HRTIMER,
+	PHASE_RCU,		/* linsched_rcu_invoke() */
+	PHASE_SCENARIO,
+	PHASE_RESCHED,		/* process_pending_resched() */
+	PHASE_TASKS,		/* linsched_current_handler(), the task models */
+	PHASE_LB_INFO,		/* compute_lb_info() */
+	PHASE_NOHZ,		/* track_nohz_residency() */
+	PHASE_SANITY,		/* run_sanity_check() */
+	NR_SIM_PHASES
+};
+
+extern int sim_profile_active;
+extern int sim_profile_interval;
+
+void __sim_profile_enter(int phase);
+void __sim_profile_exit(void);
+void sim_profile_start(void);
+void sim_profile_stop(void);
+void sim_profile_event(void);
+void print_sim_profile(void);
+
+/*
+ * phases nest, each cycle is charged to the innermost; a test of
+ * sim_profile_active when --profile_sim is not given, or the event
+ * is not sampled
+ */
+static inline void sim_profile_enter(int phase)
+{
+	if (sim_profile_active)
+		__sim_profile_enter(phase);
+}
+
+static inline void sim_profile_exit(void)
+{
+	if (sim_profile_active)
+		__sim_profile_exit();
+}
+
+#endif
@@ -39,6 +39,7 @@
 #include <asm/pgtable.h>
 
 #include <malloc.h>
+#include <stdio.h>
 void abort(void);
 
 int __linsched_curr_cpu = 0;
@@ -134,6 +135,8 @@ void panic(const char *fmt, ...)
 	vprintf(fmt, args);
 	va_end(args);
 	puts("");
+	/* abort() loses whatever stdout still buffers, e.g. the BUG line */
+	fflush(stdout);
 	abort();
 }
 
@@ -144,7 +147,12 @@ void dump_stack(void)
 struct sighand_struct *__lock_task_sighand(struct task_struct *tsk,
 					 unsigned long *flags)
 {
-	return tsk->sighand;
+	struct sighand_struct *sighand = tsk->sighand;
+
+	/* callers unlock_task_sighand(), e.g. autogroup_task_get() */
+	if (sighand)
+		spin_lock_irqsave(&sighand->siglock, *flags);
+	return sighand;
 }
 
 void linsched_change_cpu(int cpu)
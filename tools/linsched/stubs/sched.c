@@ -19,10 +19,18 @@ void call_rcu_sched(struct rcu_head *head, void (*func)(struct rcu_head *rcu))
 
 void linsched_rcu_invoke(void)
 {
-	while(rcu_head) {
-		struct rcu_head *next = rcu_head->next;
-		rcu_head->func(rcu_head);
-		rcu_head = next;
+	while (rcu_head) {
+		struct rcu_head *head = rcu_head;
+
+		/* reset the tail, which points into the heads we free, before
+		 * the callbacks run; they may queue more */
+		rcu_head = NULL;
+		rcu_curtail = &rcu_head;
+		while (head) {
+			struct rcu_head *next = head->next;
+			head->func(head);
+			head = next;
+		}
 	}
 }
 
@@ -117,6 +125,11 @@ void stop_one_cpu_nowait(unsigned int cpu, cpu_stop_fn_t fxn, void *arg,
 	struct task_struct *stop = stop_tasks[cpu];
 	struct stop_task *stop_task = task_thread_info(stop)->td->data;
 	int this_cpu = smp_processor_id();
+	u64 delay;
+
+	/* the stopper of an offline cpu is disabled, see wake_stop() */
+	if (!cpu_online(cpu))
+		return;
 
 	/*
 	 * catch a data race on simultaneous calls to stop_one_cpu_nowait, if
@@ -131,8 +144,9 @@ void stop_one_cpu_nowait(unsigned int cpu, cpu_stop_fn_t fxn, void *arg,
 	 * that our cpu has a change to drop its rq->locks since they may be
 	 * needed.
 	 */
+	delay = linsched_ipi_delay(cpu) ?: 1;
 	linsched_change_cpu(cpu);
-	hrtimer_set_expires(&stop_task->timer, ns_to_ktime(1));
+	hrtimer_set_expires(&stop_task->timer, ns_to_ktime(delay));
 	hrtimer_start_expires(&stop_task->timer, HRTIMER_MODE_REL);
 	linsched_change_cpu(this_cpu);
 }
@@ -186,13 +200,14 @@ int security_task_setscheduler(struct task_struct *p,
 	return 0;
 }
 
+/* the simulator runs with every capability, 0 allows the change */
 int cap_task_setnice(struct task_struct *p, int nice)
 {
-	return 1;
+	return 0;
 }
 
 int cap_task_setscheduler(struct task_struct *p, int policy,
 			struct sched_param *lp)
 {
-	return 1;
+	return 0;
 }
@@ -185,24 +185,25 @@ struct linsched_topology linsched_topo_db[MAX_TOPOLOGIES] = {
 	TOPO_HEX_CPU_DUAL_SOCKET_SMT
 };
 
+const char *linsched_topo_names[MAX_TOPOLOGIES] = {
+	[UNIPROCESSOR] = "uniprocessor",
+	[DUAL_CPU] = "dual_cpu",
+	[DUAL_CPU_MC] = "dual_cpu_mc",
+	[QUAD_CPU] = "quad_cpu",
+	[QUAD_CPU_MC] = "quad_cpu_mc",
+	[QUAD_CPU_DUAL_SOCKET] = "quad_cpu_dual_socket",
+	[QUAD_CPU_QUAD_SOCKET] = "quad_cpu_quad_socket",
+	[HEX_CPU_DUAL_SOCKET_SMT] = "hex_cpu_dual_socket_smt",
+};
+
 int parse_topology(char *arg)
 {
-	if (!strcmp(arg, "uniprocessor"))
-		return UNIPROCESSOR;
-	else if (!strcmp(arg, "dual_cpu"))
-		return DUAL_CPU;
-	else if (!strcmp(arg, "dual_cpu_mc"))
-		return DUAL_CPU_MC;
-	else if (!strcmp(arg, "quad_cpu"))
-		return QUAD_CPU;
-	else if (!strcmp(arg, "quad_cpu_mc"))
-		return QUAD_CPU_MC;
-	else if (!strcmp(arg, "quad_cpu_dual_socket"))
-		return QUAD_CPU_DUAL_SOCKET;
-	else if (!strcmp(arg, "quad_cpu_quad_socket"))
-		return QUAD_CPU_QUAD_SOCKET;
-	else if (!strcmp(arg, "hex_cpu_dual_socket_smt"))
-		return HEX_CPU_DUAL_SOCKET_SMT;
+	int i;
+
+	for (i = 0; i < MAX_TOPOLOGIES; i++) {
+		if (!strcmp(arg, linsched_topo_names[i]))
+			return i;
+	}
 	return UNIPROCESSOR;
 }
 
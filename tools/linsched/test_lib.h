@@ -62,6 +62,9 @@ void set_test_name(const char *name);
 void test_main(int argc, char **argv);
 
 extern struct linsched_topology linsched_topo_db[MAX_TOPOLOGIES];
+/* the names of the topologies of linsched_topo_db, as parse_topology()
+ * takes them */
+extern const char *linsched_topo_names[MAX_TOPOLOGIES];
 
 int parse_topology(char *arg);
 
@@ -277,7 +277,106 @@ void test_bal1(int argc, char **argv)
 	validate_results((int *)expected_results2);
 }
 
+/* a group limited to half of the machine by cfs bandwidth control
+ * should get half of the machine, even with a task per cpu */
+void test_bandwidth(int argc, char **argv)
+{
+	struct linsched_topology topo;
+	struct task_group *tg;
+	struct cgroup *cg;
+	u64 expected;
+	int i, count;
+
+	topo = linsched_topo_db[parse_topology(argv[2])];
+	count = topo.nr_cpus;
+
+	linsched_init(&topo);
+	cg = linsched_create_cgroup(root_cgroup, "bw");
+	tg = cgroup_tg(cg);
+	expect(!linsched_set_task_group_bandwidth(cg, 100000,
+						  count * 50000));
+	for (i = 0; i < count; i++)
+		linsched_add_task_to_group(create_task((1 << count) - 1,
+						       0, 100), cg);
+	linsched_run_sim(TEST_TICKS);
+
+	expected = (u64)count * TEST_TICKS / 2 * NSEC_PER_MSEC;
+	expect(group_exec_time(tg) > expected - expected / 50);
+	expect(group_exec_time(tg) < expected + expected / 50);
+	expect(tg->cfs_bandwidth.nr_throttled > 0);
+}
+
+/* RT tasks in a group with 30% of every cpu as RT runtime; they can't
+ * join a group without runtime */
+void test_rt_runtime(int argc, char **argv)
+{
+	struct linsched_topology topo;
+	struct task_struct *p;
+	struct task_group *tg;
+	struct cgroup *cg;
+	u64 expected, total = 0;
+	int i, count;
+
+	topo = linsched_topo_db[parse_topology(argv[2])];
+	count = topo.nr_cpus;
+
+	linsched_init(&topo);
+	cg = linsched_create_cgroup(root_cgroup, "rt");
+	tg = cgroup_tg(cg);
+	expect(!linsched_set_task_group_rt_runtime(cg, 100000, 30000));
+	for (i = 0; i < count; i++) {
+		p = linsched_create_RTfifo_task(linsched_create_sleep_run(0,
+							100), 50);
+		expect(linsched_add_task_to_group(p,
+			linsched_create_cgroup(root_cgroup, NULL)));
+		expect(!linsched_add_task_to_group(p, cg));
+	}
+	linsched_run_sim(TEST_TICKS);
+
+	for (i = 1; i <= count; i++)
+		total += task_exec_time(linsched_get_task(i));
+	expected = (u64)count * TEST_TICKS * 3 / 10 * NSEC_PER_MSEC;
+	/* throttling only happens on the tick, so allow some overrun */
+	expect(total > expected - expected / 50);
+	expect(total < expected + expected / 20);
+	for (i = 0; i < count; i++)
+		expect(tg->rt_rq[i]->rt_nr_throttled > 0);
+}
+
+/* two sessions, one with four times the tasks of the other, split the
+ * machine evenly */
+void test_autogroup(int argc, char **argv)
+{
+	struct linsched_topology topo;
+	struct cgroup *small, *large;
+	u64 small_time, large_time;
+	int i, count;
+
+	topo = linsched_topo_db[parse_topology(argv[2])];
+	count = topo.nr_cpus;
+
+	linsched_init(&topo);
+	small = linsched_create_autogroup(create_task((1 << count) - 1,
+						      0, 100));
+	expect(small != root_cgroup);
+	for (i = 1; i < count; i++)
+		linsched_add_task_to_group(create_task((1 << count) - 1,
+						       0, 100), small);
+	large = linsched_create_autogroup(create_task((1 << count) - 1,
+						      0, 100));
+	for (i = 1; i < 4 * count; i++)
+		linsched_add_task_to_group(create_task((1 << count) - 1,
+						       0, 100), large);
+	linsched_run_sim(TEST_TICKS);
+
+	small_time = group_exec_time(cgroup_tg(small));
+	large_time = group_exec_time(cgroup_tg(large));
+	expect(small_time > large_time - large_time / 20);
+	expect(small_time < large_time + large_time / 20);
+}
+
 void test_list(int argc, char **argv);
+void test_topologies(int argc, char **argv);
 
 struct test {
 	char *name;
@@ -290,25 +389,36 @@ struct test tests[] = {
 	TEST(basic_bal1),
 	TEST(basic_bal2),
 	TEST(bal1),
+	TEST(bandwidth),
+	TEST(rt_runtime),
+	TEST(autogroup),
 	TEST(list),
+	TEST(topologies),
 };
 
 void test_list(int argc, char **argv)
 {
 	int i;
 	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
-		if (tests[i].fn != test_list)
+		if (tests[i].fn != test_list && tests[i].fn != test_topologies)
 			puts(tests[i].name);
 	}
 }
 
+void test_topologies(int argc, char **argv)
+{
+	int i;
+	for (i = 0; i < MAX_TOPOLOGIES; i++)
+		puts(linsched_topo_names[i]);
+}
+
 void usage(char **argv)
 {
-	fprintf(stderr, "Usage: %s <test name> <topo>|list\n", argv[0]);
+	fprintf(stderr, "Usage: %s <test name> <topo>|list|topologies\n", argv[0]);
 	exit(1);
 }
 
-void linsched_test_main(int argc, char **argv)
+int linsched_test_main(int argc, char **argv)
 {
 	int i;
 	if (argc < 2) {
@@ -321,8 +431,9 @@ void linsched_test_main(int argc, char **argv)
 	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
 		if (!strcmp(argv[1], tests[i].name)) {
 			tests[i].fn(argc, argv);
-			return;
+			return 0;
 		}
 	}
 	usage(argv);
+	return 1;
 }
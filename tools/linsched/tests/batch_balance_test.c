@@ -31,7 +31,7 @@
 
 #define NLS 3
 
-void linsched_test_main(int argc, char **argv)
+int linsched_test_main(int argc, char **argv)
 {
 	struct linsched_topology topo = TOPO_QUAD_CPU_QUAD_SOCKET;
 	int i;
@@ -75,4 +75,5 @@ void linsched_test_main(int argc, char **argv)
 
 	expect_failure();
 	expect(total >= TOTAL_CPUTIME * 95/100);
+	return 0;
 }
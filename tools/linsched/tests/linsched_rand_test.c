@@ -186,11 +186,51 @@ int test_linsched_lognormal(int argc, char **argv)
 	return 0;
 }
 
+/* test the linsched_gen_empirical_dist() function on a fixed table
+ * mixing point masses and a bin */
+int test_linsched_empirical(int argc, char **argv)
+{
+	unsigned int seed =
+	    (unsigned int) simple_strtoul(argv[2], NULL, 0);
+	int n = simple_strtoul(argv[3], NULL, 0);
+	double lo[] = { 100, 1000, 5000 };
+	double hi[] = { 100, 1000, 6000 };
+	double weights[] = { 6, 3, 1 };
+	int counts[3] = { 0, 0, 0 };
+	struct rand_dist *rdist = linsched_init_empirical(lo, hi, weights, 3,
+							  seed);
+	struct empirical_dist *edist = rdist->dist;
+	double avg, val, sum = 0, sum_sq = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		val = linsched_gen_empirical_dist(rdist);
+		sum += val;
+		sum_sq += (val * val);
+		if (val == 100)
+			counts[0]++;
+		else if (val == 1000)
+			counts[1]++;
+		else if (val >= 5000 && val < 6000)
+			counts[2]++;
+	}
+
+	avg = sum / (double) n;
+	fprintf(stdout, "\nAVG(mu): %f, DEVIATION(sd) = %f\n", avg,
+		calc_deviation(avg, sum_sq, n));
+	fprintf(stdout, "E.AVG:   %f\n", edist->table->mean);
+	for (i = 0; i < 3; i++)
+		fprintf(stdout, "bin %d: %f (expected %f)\n", i,
+			counts[i] / (double) n, weights[i] / 10);
+	linsched_destroy_empirical(rdist);
+	return 0;
+}
+
 void print_usage(char *cmd)
 {
 	printf("\nUsage: %s <TEST_TYPE> [[PARAMETERS]]\n", cmd);
 	printf("\t TEST_TYPE : rand / rand_range / gaussian / poisson / exp /"
-								"lnorm\n");
+							"lnorm / empirical\n");
 	printf("\t PARAMETERS for rand : seed NO_OF_SAMPLES\n");
 	printf("\t PARAMETERS for rand_range : seed <LOW> <HIGH>"
 						" NO_OF_SAMPLES\n");
@@ -200,11 +240,13 @@ void print_usage(char *cmd)
 	printf("\t PARAMETERS for exponential : seed mu NO_OF_SAMPLES\n");
 	printf("\t PARAMETERS for lognormal :"
 			" seed meanlog sdlog NO_OF_SAMPLES\n");
+	printf("\t PARAMETERS for empirical : seed NO_OF_SAMPLES\n");
 	printf("EXAMPLE : %s rand 12345 10000\n", cmd);
 	printf("EXAMPLE : %s gaussian 12345 1000 10 10000\n", cmd);
 	printf("EXAMPLE : %s poisson 12345 500 10000\n", cmd);
 	printf("EXAMPLE : %s exp 12345 500 10000\n", cmd);
 	printf("EXAMPLE : %s lnorm 12345 1000 10 10000\n", cmd);
+	printf("EXAMPLE : %s empirical 12345 10000\n", cmd);
 }
 
 /* testing linsched_rand()
@@ -243,6 +285,9 @@ int linsched_test_main(int argc, char **argv)
 	else if (argc == 6 && !strcmp(argv[1], "lnorm"))
 		test_linsched_lognormal(argc, argv);
 
+	else if (argc == 4 && !strcmp(argv[1], "empirical"))
+		test_linsched_empirical(argc, argv);
+
 	else
 		print_usage(argv[0]);
 
@@ -0,0 +1,163 @@
+#
+# Shared helpers for the linsched test scripts: parsing the metrics the
+# simulators print with the global --print_* options, and small sample
+# statistics (Student t confidence intervals, Mann-Whitney U and the
+# bootstrap) without scipy.
+
+import math
+import random
+import re
+
+# name: (pattern on the simulator output, 1 if lower is better or -1
+# if higher is better, 0 if neither)
+METRICS = {
+    "wake_mean": (r"^wakeup: .* mean = (\d+)", 1),
+    "wake_p50": (r"^wakeup: .* p50 = (\d+)", 1),
+    "wake_p99": (r"^wakeup: .* p99 = (\d+)", 1),
+    "wake_p999": (r"^wakeup: .* p99\.9 = (\d+)", 1),
+    "wake_max": (r"^wakeup: .* max = (\d+)", 1),
+    "preempt_mean": (r"^preempt: .* mean = (\d+)", 1),
+    "preempt_p99": (r"^preempt: .* p99 = (\d+)", 1),
+    "imbalance": (r"^average imbalance: ([\d.]+)", 1),
+    "work": (r"^CGroup = / \(0\), exec_time = (\d+)", -1),
+    "decisions": (r"^decisions: (\d+)", 0),
+}
+
+# the global options that print everything in METRICS
+STAT_OPTIONS = ["--print_latency_stats", "--print_average_imbalance",
+                "--print_cgroup_stats", "--print_decisions"]
+
+
+def parse_metrics(text, names=None):
+    """the metrics found in simulator output, by name"""
+    values = {}
+    for name in names or METRICS:
+        m = re.search(METRICS[name][0], text, re.M)
+        if m:
+            values[name] = float(m.group(1))
+    return values
+
+
+def mean(xs):
+    return sum(xs) / float(len(xs))
+
+
+def stdev(xs):
+    """sample standard deviation"""
+    if len(xs) < 2:
+        return 0.0
+    m = mean(xs)
+    return math.sqrt(sum((x - m) ** 2 for x in xs) / (len(xs) - 1))
+
+
+def _betacf(a, b, x):
+    # continued fraction for the incomplete beta function
+    # (Numerical Recipes, betacf)
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > 1e-300 else 1e-300)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > 1e-300 else 1e-300)
+        c = 1.0 + aa / c
+        c = c if abs(c) > 1e-300 else 1e-300
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > 1e-300 else 1e-300)
+        c = 1.0 + aa / c
+        c = c if abs(c) > 1e-300 else 1e-300
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def _betai(a, b, x):
+    """regularized incomplete beta function I_x(a, b)"""
+    if x <= 0:
+        return 0.0
+    if x >= 1:
+        return 1.0
+    lbt = (math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) +
+           a * math.log(x) + b * math.log(1 - x))
+    if x < (a + 1) / (a + b + 2):
+        return math.exp(lbt) * _betacf(a, b, x) / a
+    return 1 - math.exp(lbt) * _betacf(b, a, 1 - x) / b
+
+
+def t_cdf(t, df):
+    p = 0.5 * _betai(df / 2.0, 0.5, df / (df + t * t))
+    return 1 - p if t > 0 else p
+
+
+def t_quantile(p, df):
+    """inverse of t_cdf, by bisection"""
+    lo, hi = -1e3, 1e3
+    for _ in range(200):
+        mid = (lo + hi) / 2
+        if t_cdf(mid, df) < p:
+            lo = mid
+        else:
+            hi = mid
+    return (lo + hi) / 2
+
+
+def mean_ci(xs, confidence=0.95):
+    """(mean, half width of the confidence interval of the mean); the
+    half width is 0 for fewer than two samples"""
+    if len(xs) < 2:
+        return mean(xs), 0.0
+    t = t_quantile(1 - (1 - confidence) / 2, len(xs) - 1)
+    return mean(xs), t * stdev(xs) / math.sqrt(len(xs))
+
+
+def parse_seeds(spec):
+    """seeds from "1,2,7" or "1-20" or a mix of both"""
+    seeds = []
+    for part in spec.split(","):
+        if "-" in part:
+            lo, hi = part.split("-")
+            seeds.extend(range(int(lo), int(hi) + 1))
+        else:
+            seeds.append(int(part))
+    return seeds
+
+
+def mann_whitney(xs, ys):
+    """two-sided p-value of the Mann-Whitney U test, from the normal
+    approximation with tie correction; fine for the tens to thousands
+    of runs we compare"""
+    n1, n2 = len(xs), len(ys)
+    if not n1 or not n2:
+        return 1.0
+    values = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+    rank_sum, ties, i = 0.0, 0.0, 0
+    while i < len(values):
+        j = i
+        while j < len(values) and values[j][0] == values[i][0]:
+            j += 1
+        rank = (i + j + 1) / 2.0
+        rank_sum += rank * sum(1 for k in range(i, j) if not values[k][1])
+        ties += (j - i) ** 3 - (j - i)
+        i = j
+    u = rank_sum - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(var)
+    return max(0.0, min(1.0, math.erfc(max(z, 0) / math.sqrt(2))))
+
+
+def bootstrap_ci(stat, n, resamples=1000, confidence=0.95, rng=None):
+    """percentile bootstrap interval of stat(indices) over n samples"""
+    rng = rng or random.Random(0)
+    draws = sorted(stat([rng.randrange(n) for _ in range(n)])
+                   for _ in range(resamples))
+    lo = int((1 - confidence) / 2 * resamples)
+    return draws[lo], draws[min(resamples - 1, resamples - 1 - lo)]
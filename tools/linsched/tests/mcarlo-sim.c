@@ -6,34 +6,175 @@
  * tasks with random run / sleep distributions chosen from the set of available
  * distributions - lognormal, normal, poisson, exponential. After the simulation,
  * a report is generated that prints out all the task and group statistics for
- * each run of the simulation. Presently this simulation does not support
- * hierarchies of task groups -- just flat task groups.
+ * each run of the simulation. Task groups may be nested (see
+ * linsched_create_sim()), in which case the report also breaks the
+ * runtime down per level of the hierarchy.
+ *
+ * With --precision, the duration is a budget: the sim runs in batches
+ * (--batch ms each, after --warmup ms) until the batch means of its
+ * metrics are known to within precision percent (see
+ * linsched_run_sim_batches()).
+ *
+ * With --pipeline, the tasks of a producer / consumer pipeline (see
+ * linsched_pipeline.h) run next to the task groups, and the report
+ * ends with its item latency and throughput. Likewise --server runs
+ * an open loop request serving model (see linsched_server.h) and
+ * reports its response times and the load at which its SLO breaks,
+ * --churn runs tasks that fork short lived children (see
+ * linsched_churn.h) and reports their fork to first run latency and
+ * the spawn rate sustained, --locks runs tasks contending for locks
+ * (see linsched_lock.h) and reports hold and wait times and convoys,
+ * and --io runs tasks doing IO to simulated block devices (see
+ * linsched_io.h) and reports their latencies and the iowait time of
+ * the cpus. The shares file is optional with any of them.
+ *
+ * --irq adds device interrupts that steal cpu time (see
+ * linsched_irq.h) under whatever tasks run, and reports the irq time
+ * and cpu_power of each cpu. The shares file is optional with it too.
+ *
+ * --rt runs periodic or sporadic SCHED_FIFO / SCHED_RR tasks (see
+ * linsched_rt.h) next to the other tasks, and reports their deadline
+ * misses, response times and jitter and the RT throttling of the
+ * cpus. The shares file is optional with it too.
+ *
+ * --pool runs work-stealing thread pools (see linsched_pool.h) next to
+ * the other tasks, and reports their job latencies, how the workers
+ * found their jobs, the cpu time they spent spinning and where the
+ * parked workers were woken. The shares file is optional with it too.
  */
 
 #include "linsched.h"
 #include "linsched_rand.h"
 #include "linsched_sim.h"
+#include "linsched_scenario.h"
+#include "linsched_pipeline.h"
+#include "linsched_server.h"
+#include "linsched_churn.h"
+#include "linsched_lock.h"
+#include "linsched_io.h"
+#include "linsched_irq.h"
+#include "linsched_rt.h"
+#include "linsched_pool.h"
 #include "test_lib.h"
 #include <string.h>
 #include <getopt.h>
+#include <malloc.h>
 #include <stdio.h>
 
+/* the task models that can run next to (or instead of) the task groups
+ * of the shares file, each from a file given with its option */
+struct model {
+	const char *name;	/* long option and report name */
+	int opt;
+	int workload;		/* has tasks of its own */
+	void *(*load)(char *file, const struct cpumask *cpus,
+		      unsigned int *rand_state);
+	void (*print)(void *model);
+	void (*destroy)(void *model);
+	char file[256];
+	void *state;
+};
+
+#define DEFINE_MODEL_LOAD(model, load_fn)				\
+static void *model##_load(char *file, const struct cpumask *cpus,	\
+			  unsigned int *rand_state)			\
+{									\
+	return load_fn(file, cpus, rand_state);				\
+}
+
+#define DEFINE_MODEL_REPORT(model, print_fn, destroy_fn)		\
+static void model##_print(void *m)					\
+{									\
+	print_fn(m);							\
+}									\
+static void model##_destroy(void *m)					\
+{									\
+	destroy_fn(m);							\
+}
+
+static void *scenario_load(char *file, const struct cpumask *cpus,
+			   unsigned int *rand_state)
+{
+	struct linsched_scenario *scn = linsched_load_scenario(file);
+
+	if (scn)
+		linsched_start_scenario(scn);
+	return scn;
+}
+
+static void *irq_load(char *file, const struct cpumask *cpus,
+		      unsigned int *rand_state)
+{
+	return linsched_load_irq(file, rand_state);
+}
+
+DEFINE_MODEL_LOAD(pipeline, linsched_load_pipeline)
+DEFINE_MODEL_LOAD(server, linsched_load_server)
+DEFINE_MODEL_LOAD(churn, linsched_load_churn)
+DEFINE_MODEL_LOAD(locks, linsched_load_locks)
+DEFINE_MODEL_LOAD(io, linsched_load_io)
+DEFINE_MODEL_LOAD(rt, linsched_load_rt)
+DEFINE_MODEL_LOAD(pool, linsched_load_pools)
+
+DEFINE_MODEL_REPORT(scenario, linsched_print_scenario_report,
+		    linsched_destroy_scenario)
+DEFINE_MODEL_REPORT(pipeline, linsched_print_pipeline_report,
+		    linsched_destroy_pipeline)
+DEFINE_MODEL_REPORT(server, linsched_print_server_report,
+		    linsched_destroy_server)
+DEFINE_MODEL_REPORT(churn, linsched_print_churn_report,
+		    linsched_destroy_churn)
+DEFINE_MODEL_REPORT(locks, linsched_print_lock_report, linsched_destroy_locks)
+DEFINE_MODEL_REPORT(io, linsched_print_io_report, linsched_destroy_io)
+DEFINE_MODEL_REPORT(irq, linsched_print_irq_report, linsched_destroy_irq)
+DEFINE_MODEL_REPORT(rt, linsched_print_rt_report, linsched_destroy_rt)
+DEFINE_MODEL_REPORT(pool, linsched_print_pool_report, linsched_destroy_pools)
+
+#define MODEL(model, opt, workload)					\
+	{ #model, opt, workload, model##_load, model##_print,		\
+	  model##_destroy }
+
+/* loaded, and reported on, in this order */
+static struct model models[] = {
+	MODEL(scenario, 'S', 0),
+	MODEL(pipeline, 'p', 1),
+	MODEL(server, 'r', 1),
+	MODEL(churn, 'C', 1),
+	MODEL(locks, 'l', 1),
+	MODEL(io, 'i', 1),
+	MODEL(irq, 'I', 1),
+	MODEL(rt, 'R', 1),
+	MODEL(pool, 'w', 1),
+};
+
 void print_usage(char *cmd)
 {
+	int i;
+
 	printf("Usage: %s -t <topo> -f <SHARES_FILE>"
-	       " --duration <SIMDUARATION> [-c <cpus> -m <monitor_cpus>] [-s seed]\n", cmd);
+	       " --duration <SIMDUARATION> [-c <cpus> -m <monitor_cpus>] [-s seed]"
+	       " [--precision <PCT> [--batch <MS>] [--warmup <MS>]]", cmd);
+	for (i = 0; i < ARRAY_SIZE(models); i++)
+		printf(" [--%s <FILE>]", models[i].name);
+	printf("\n");
 }
 
 void run_mcarlo_sim(char *stopo, char *tg_file, int simduration,
 		    unsigned int seed, struct cpumask *cpus,
-		    struct cpumask *monitor_cpus)
+		    struct cpumask *monitor_cpus, double precision,
+		    int batch, int warmup)
 {
+	struct linsched_batch_means *bm = NULL;
 	struct linsched_topology topo = linsched_topo_db[parse_topology(stopo)];
 	struct linsched_sim *lsim;
 	unsigned int *rand_state = linsched_init_rand(seed);
+	int i;
 
 	linsched_init(&topo);
-	lsim = linsched_create_sim(tg_file, cpus, rand_state);
+	if (tg_file[0])
+		lsim = linsched_create_sim(tg_file, cpus, rand_state);
+	else
+		lsim = calloc(1, sizeof(struct linsched_sim));
 
 	if (!cpumask_subset(cpu_online_mask, cpus)) {
 		/* split the system into two "cpuset"s with default attrs */
@@ -43,9 +184,37 @@ void run_mcarlo_sim(char *stopo, char *tg_file, int simduration,
 		partition_sched_domains(2, doms, NULL);
 	}
 
+	for (i = 0; lsim && i < ARRAY_SIZE(models); i++) {
+		struct model *m = &models[i];
+
+		if (!m->file[0])
+			continue;
+		m->state = m->load(m->file, cpus, rand_state);
+		if (!m->state) {
+			fprintf(stderr, "failed to load %s %s.\n", m->name,
+				m->file);
+			return;
+		}
+	}
+
 	if (lsim) {
-		linsched_run_sim(simduration);
+		if (precision > 0)
+			bm = linsched_run_sim_batches(lsim, warmup, batch,
+						      simduration, precision);
+		else
+			linsched_run_sim(simduration);
 		print_report(lsim);
+		if (bm)
+			linsched_print_batch_means(bm);
+		for (i = 0; i < ARRAY_SIZE(models); i++) {
+			struct model *m = &models[i];
+
+			if (!m->state)
+				continue;
+			m->print(m->state);
+			m->destroy(m->state);
+			m->state = NULL;
+		}
 		linsched_destroy_sim(lsim);
 	} else {
 		fprintf(stderr, "failed to create simulation.\n");
@@ -55,26 +224,42 @@ void run_mcarlo_sim(char *stopo, char *tg_file, int simduration,
 
 int linsched_test_main(int argc, char **argv)
 {
-	int c, simduration = 0;
+	int c, simduration = 0, batch = 1000, warmup = 1000;
+	double precision = 0;
 	char tg_file[256] = "", topo[256] = "";
+	char optstring[64] = "t:f:d:s:c:m:P:B:W:";
 	unsigned int seed = getticks();
+	int i, workload;
 
 	struct cpumask cpus = CPU_MASK_ALL, monitor_cpus = CPU_MASK_NONE;
 
+	struct option long_options[8 + ARRAY_SIZE(models) + 1] = {
+		{"topo", required_argument, 0, 't'},
+		{"tg_file", required_argument, 0, 'f'},
+		{"duration", required_argument, 0, 'd'},
+		{"cpus", required_argument, 0, 'c'},
+		{"monitor_cpus", required_argument, 0, 'm'},
+		{"precision", required_argument, 0, 'P'},
+		{"batch", required_argument, 0, 'B'},
+		{"warmup", required_argument, 0, 'W'},
+	};
+
+	/* the rest of the options come from the models */
+	for (i = 0; i < ARRAY_SIZE(models); i++) {
+		struct option *o = &long_options[8 + i];
+
+		o->name = models[i].name;
+		o->has_arg = required_argument;
+		o->val = models[i].opt;
+		sprintf(optstring + strlen(optstring), "%c:", models[i].opt);
+	}
+
 	while (1) {
-		static struct option const long_options[] = {
-			{"topo", required_argument, 0, 't'},
-			{"tg_file", required_argument, 0, 'f'},
-			{"duration", required_argument, 0, 'd'},
-			{"cpus", required_argument, 0, 'c'},
-			{"monitor_cpus", required_argument, 0, 'm'},
-			{0, 0, 0, 0}
-		};
 		/* getopt_long stores the option index here. */
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "t:f:d:s:c:m:",
-					 long_options, &option_index);
+		c = getopt_long(argc, argv, optstring, long_options,
+				&option_index);
 
 		/* Detect the end of the options. */
 		if (c == -1)
@@ -102,17 +287,38 @@ int linsched_test_main(int argc, char **argv)
 		case 'm':
 			cpulist_parse(optarg, &monitor_cpus);
 			break;
+		case 'P':
+			sscanf(optarg, "%lf", &precision);
+			break;
+		case 'B':
+			batch = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			warmup = simple_strtoul(optarg, NULL, 0);
+			break;
 		case '?':
 			/* getopt_long already printed an error message. */
 			break;
+		default:
+			for (i = 0; i < ARRAY_SIZE(models); i++)
+				if (c == models[i].opt)
+					strcpy(models[i].file, optarg);
+			break;
 		}
 	}
 
-	if (strcmp(topo, "") && strcmp(tg_file, "") && simduration &&
-	    !cpumask_intersects(&cpus, &monitor_cpus)) {
+	/* something has to run: task groups or a model with tasks */
+	workload = tg_file[0] != '\0';
+	for (i = 0; i < ARRAY_SIZE(models); i++)
+		if (models[i].workload && models[i].file[0])
+			workload = 1;
+
+	if (strcmp(topo, "") && workload && simduration &&
+	    !cpumask_intersects(&cpus, &monitor_cpus) && batch > 0) {
 		fprintf(stdout, "\nTOPO = %s, tg_file = %s, duration = %d\n",
 				topo, tg_file, simduration);
-		run_mcarlo_sim(topo, tg_file, simduration, seed, &cpus, &monitor_cpus);
+		run_mcarlo_sim(topo, tg_file, simduration, seed, &cpus,
+			       &monitor_cpus, precision, batch, warmup);
 	} else
 		print_usage(argv[0]);
 
@@ -6,24 +6,39 @@
  */
 
 #include "linsched.h"
+#include "linsched_io.h"
 #include <strings.h>
 #include <stdio.h>
 
 void usage(void)
 {
 	fprintf(stdout, "\nUsage: perf_replay \
-			<PATH_TO_DIRECTORY_WITH_RLOGS> <SIM_DURATION>\n");
+			<PATH_TO_DIRECTORY_WITH_RLOGS> <SIM_DURATION> \
+			[<IO_FILE>]\n");
 }
 
 int linsched_test_main(int argc, char **argv)
 {
 	int perf_error = 0, duration;
+	struct linsched_io *io = NULL;
 
 	/* Initialize linsched. */
 	linsched_init(NULL);
 
-	if (argc == 3)
-		perf_error = linsched_create_perf_tasks(argv[1]);
+	/* IOWAIT events wait for the first device of the io file */
+	if (argc == 4) {
+		io = linsched_load_io(argv[3], cpu_online_mask,
+				      linsched_init_rand(1));
+		if (!io) {
+			fprintf(stderr, "\nfailed to load io %s.Exiting ...\n",
+				argv[3]);
+			return -1;
+		}
+	}
+
+	if (argc == 3 || argc == 4)
+		perf_error = linsched_create_perf_tasks(argv[1],
+							io ? io->devs[0] : NULL);
 	else {
 		fprintf(stderr, "\ninvalid number of arguments.Exiting ...\n");
 		usage();
@@ -40,6 +55,8 @@ int linsched_test_main(int argc, char **argv)
 	linsched_run_sim(duration);
 
 	linsched_show_schedstat();
+	if (io)
+		linsched_print_io_report(io);
 
 	/* we always want these */
 	linsched_global_options.print_tasks = 1;
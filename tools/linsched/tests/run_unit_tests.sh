@@ -69,6 +69,13 @@ for i in "$@"; do
          done
        done
      done
+ elif [ "$i" = "empirical" ]; then
+     for seed in ${seed_list[@]}; do
+       for n in ${n_list[@]}; do
+         echo -e "\nRunning empirical with seed=$seed,n=$n"
+         ./linsched_rand_test $i $seed $n
+       done
+     done
  else
     ./$i || die "$i failed"
   fi